@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "pico/stdlib.h"
+#include "functions.hpp"
+#include "ssd1306_i2c.h"
+
+/*
+ Host benchmark for the spatial grid (cmake -DPICO_PLATFORM=host, then run spatial_bench). N 3x3 pellets get laid
+ out on a 4 pixel grid so none of them touch, then one of them gets moved back and forth and the grid counters say
+ how much looking around each move took. If the grid is doing its job candidates/move stays flat however big N gets.
+ redrawn/move is how many whole sprite records got read, everything else only reads the boxes
+*/
+
+#define MOVES 2000
+
+int main(){
+    printf("    N  candidates/move  cells/move  queries/move  redrawn/move  us/move\n");
+
+    for(int n : {16, 64, 256, 512}){
+        DeleteEverything();
+
+        std::vector<SpriteHandle> handles;
+        for(int i = 0; i < n; i++){
+            handles.push_back(CreateNewSprite((i % 32) * 4, (i / 32) * 4 % 64, sprites.at("SnakePellet"), "p" + std::to_string(i)));
+        }
+
+        ResetSpatialIndexStats();
+        uint64_t start = time_us_64();
+
+        for(int k = 0; k < MOVES; k++) MoveSprite(handles[0], {(float)(k % 2 ? 1 : -1), 0}, false);
+
+        uint64_t elapsed = time_us_64() - start;
+        SpatialIndexStats stats = GetSpatialIndexStats();
+
+        printf("%5d  %15.1f  %10.1f  %12.1f  %12.1f  %7.2f\n", n, stats.candidates / (float)MOVES, stats.cellsVisited / (float)MOVES,
+               stats.queries / (float)MOVES, stats.redrawn / (float)MOVES, elapsed / (float)MOVES);
+    }
+
+    return 0;
+}
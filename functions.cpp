@@ -9,19 +9,99 @@
 #include <cmath>
 #include <map>
 #include <unordered_set>
+#include <list>
+#include <cstring>
+#include <algorithm>
 #include "sprites.h"
 #include "functions.hpp"
 #include "pico/stdlib.h"
 #include "ssd1306_i2c.h"
+#if !PICO_NO_HARDWARE
 #include "pico/rand.h"
+#endif
+#include "ssd1306_transform.h"
+#include "sprite_arena.h"
 
 using namespace std;
 using Callback = std::function<void()>;
  
-map<string, sprite_screen_structure> allSprites{};
+// The sprite registry. The sprites are packed at the front of the dense arrays, one column per thing, and removing
+// one moves the last one into the gap so loops over every sprite walk straight through memory. A handle goes through
+// its slot to find where the sprite is now, removing a sprite bumps the slot's generation so old handles stop finding
+// anything instead of finding whatever gets the slot next. Names get looked up once on the way in and that's it
+struct SpriteBox
+{
+    int x0, y0;
+    int x1, y1; // one past the edge, nothing on screen if x1 <= x0
+};
+
+#define MAX_SPRITE_COPIES 4 // a wrapping sprite sitting over a corner of its wrap area shows up in all four
+
+// a box per place a sprite got drawn. Only wrapping sprites ever have more than one, and keeping the copies apart
+// means the empty space between them doesn't count as covered
+struct SpriteBoxes
+{
+    SpriteBox box[MAX_SPRITE_COPIES];
+    int count;
+};
+
+vector<uint16_t> slotGeneration;
+vector<uint16_t> slotDense; // where each slot's sprite is in the dense arrays
+vector<uint16_t> freeSlots;
+
+vector<SpriteHandle> denseHandle;
+vector<SpriteBoxes> denseBox; // what each one covers on screen as it was last drawn, the overlap scans only read this
+// The rest of a sprite stays together in one record on purpose. GetSprite/FindSprite hand out a pointer to it that
+// callers change pos, size and the rest through, and DrawToGlobal takes the same struct for sprites that aren't in
+// the registry at all, so splitting pos/size/img out would break both. Nothing that loops over lots of sprites reads
+// the records, the grid and the overlap and rebuild queries only touch denseBox, and the record only gets read for
+// the handful that end up being redrawn (GetSpatialIndexStats().redrawn counts them, spatial_bench prints it)
+vector<sprite_screen_structure> denseSprite;
+vector<string> denseName;
+
+unordered_map<string, SpriteHandle> spriteNames;
+
+// Spatial grid over the drawn boxes. The screen is split into pages (8 rows) by 8 column wide buckets and each cell
+// lists the slots of the sprites whose box touches it. It gets updated whenever a box changes, so anything looking
+// for what's near a box only looks at the sprites in the cells the box covers, however many sprites there are
+#define GRID_BUCKET_WIDTH 8
+#define GRID_COLUMNS (128 / GRID_BUCKET_WIDTH)
+#define GRID_PAGES 8
+
+vector<uint16_t> gridCells[GRID_PAGES][GRID_COLUMNS];
+vector<uint32_t> slotVisited; // per slot, the last query that found it, so sprites in several cells only count once
+uint32_t queryStamp = 0;
+
+SpatialIndexStats spatialStats = {};
+
+// Retained mode. The grid cells double as the screen's 8x8 tiles: moving a registered sprite around only marks the
+// tiles its old and new boxes touch, then ComposeDirtyTiles (Update does it) rebuilds each of those from nothing
+bool retainedMode = false;
+uint16_t dirtyTiles[GRID_PAGES] = {}; // a bit per column bucket
+
+// What's under the registered sprites, same layout as bufferGlobal. When a sprite's box first covers a pixel no other
+// box does, whatever was drawn there (DrawText, lines, rects) gets copied in here, and rebuilding a box in immediate
+// mode starts from this instead of a cleared box. Only the pixels some box covers mean anything
+uint8_t spriteBackground[128 * GRID_PAGES] = {};
+
+uint32_t spriteSequence = 0; // goes up with every sprite made, the last tie break in the draw order
 
+uint16_t currentScene = 0; // goes up with every BeginScene, new sprites get tagged with it
+vector<uint32_t> sceneMarks; // the arena mark each open scene started at, sceneMarks[s] is where ending scene s resets to
 
-int lastTime = to_ms_since_boot(get_absolute_time());
+
+int lastTime = to_ms_since_boot(get_absolute_time()); // kept for old main loops, nothing in here reads it anymore
+
+// Frame scheduler. Update() is the frame boundary, it works out how long the last frame took once (in microseconds)
+// and everything that moves uses that same delta, then if there's a target fps it sleeps until the next frame is due
+uint64_t frameStartUs = 0;
+uint64_t nextDeadlineUs = 0;
+uint32_t frameDeltaUs = 0;
+uint32_t framePeriodUs = 0; // 0 means don't pace, just go as fast as possible
+
+FrameStats frameStats = {};
+double frameMeanUs = 0; // running mean and sum of squares for the jitter, Welford's method
+double frameM2 = 0;
 
 struct Animation
 {
@@ -37,8 +117,7 @@ struct Animation
     Vector2 destination;
 
     string name = "";
-    sprite_screen_structure *sprite; // this points to a sprite in the global sprite list, therefore this animation has to delete
-    // if its ever a nullptr (need a lot of robust null checks here)
+    SpriteHandle sprite = 0; // stops finding anything if the sprite gets removed, so nothing dangles
 
     bool started = false; //handles whether we've started moving or not
 
@@ -79,21 +158,347 @@ char *ConvertString(string temp, char test[])
     return test;
 }
 
+/// @brief gives a sprite its bitmap out of the sprite arena, zeroed. There's room for it turned sideways as well so
+/// quarter turns can happen in place
+static bool AllocSpriteImage(sprite_screen_structure& sprite){
+    int width = (int)sprite.size.x, height = (int)sprite.size.y;
+    int bytes = max(width * ((height + 7) / 8), height * ((width + 7) / 8));
+
+    sprite.img = SpriteArenaAlloc(bytes);
+    sprite.imgBytes = sprite.img ? bytes : 0;
+    sprite.scene = currentScene;
+
+    return sprite.img != nullptr; // if it didn't fit it's counted in the arena stats failures
+}
+
+static void FreeSpriteMask(sprite_screen_structure& sprite){
+    if(!sprite.ownMask) return;
+
+    SpriteArenaFree(sprite.ownMask, sprite.imgBytes);
+    if(sprite.mask == sprite.ownMask) sprite.mask = nullptr;
+    sprite.ownMask = nullptr;
+}
+
+static void FreeSpriteImage(sprite_screen_structure& sprite){
+    FreeSpriteMask(sprite);
+    SpriteArenaFree(sprite.img, sprite.imgBytes);
+    sprite.img = nullptr;
+    sprite.imgBytes = 0;
+}
+
+/// @brief arena memory for something belonging to scene owner. If that scene has had others opened since it goes
+/// under the mark they reset to, so ending them doesn't take it
+static uint8_t *AllocInScene(int bytes, uint16_t owner){
+    if(owner < sceneMarks.size()) return SpriteArenaAllocBelow(bytes, sceneMarks[owner]);
+    return SpriteArenaAlloc(bytes);
+}
+
+static inline bool BoxesOverlap(const SpriteBox& a, const SpriteBox& b){
+    return a.x1 > a.x0 && b.x1 > b.x0 &&
+           a.x0 < b.x1 && b.x0 < a.x1 &&
+           a.y0 < b.y1 && b.y0 < a.y1;
+}
+
+/// @brief whether box overlaps any of a sprite's copies
+static inline bool OverlapsAny(const SpriteBox& box, const SpriteBoxes& boxes){
+    for(int i = 0; i < boxes.count; i++){
+        if(BoxesOverlap(box, boxes.box[i])) return true;
+    }
+
+    return false;
+}
+
+static inline bool SameBoxes(const SpriteBoxes& a, const SpriteBoxes& b){
+    if(a.count != b.count) return false;
+
+    for(int i = 0; i < a.count; i++){
+        const SpriteBox& x = a.box[i];
+        const SpriteBox& y = b.box[i];
+        if(x.x0 != y.x0 || x.y0 != y.y0 || x.x1 != y.x1 || x.y1 != y.y1) return false;
+    }
+
+    return true;
+}
+
+/// @brief the cells a box touches, inclusive. false if it's empty
+static inline bool GridRange(const SpriteBox& box, int& col0, int& col1, int& page0, int& page1){
+    if(box.x1 <= box.x0 || box.y1 <= box.y0) return false;
+
+    col0 = max(0, box.x0 / GRID_BUCKET_WIDTH);
+    col1 = min(GRID_COLUMNS - 1, (box.x1 - 1) / GRID_BUCKET_WIDTH);
+    page0 = max(0, box.y0 >> 3);
+    page1 = min(GRID_PAGES - 1, (box.y1 - 1) >> 3);
+
+    return col0 <= col1 && page0 <= page1;
+}
+
+/// @brief the cells any of a sprite's copies touch, a bit per column bucket for each page. Copies that share a
+/// cell only count once
+static void GridCells(const SpriteBoxes& boxes, uint16_t cells[GRID_PAGES]){
+    fill(cells, cells + GRID_PAGES, 0);
+
+    for(int i = 0; i < boxes.count; i++){
+        int col0, col1, page0, page1;
+        if(!GridRange(boxes.box[i], col0, col1, page0, page1)) continue;
+
+        uint16_t bits = (uint16_t)(((1u << (col1 + 1)) - 1) & ~((1u << col0) - 1));
+        for(int page = page0; page <= page1; page++) cells[page] |= bits;
+    }
+}
+
+static void GridInsert(uint16_t slot, int page, uint16_t columns){
+    for(int col = 0; columns; col++, columns >>= 1){
+        if(columns & 1) gridCells[page][col].push_back(slot);
+    }
+}
+
+static void GridRemove(uint16_t slot, int page, uint16_t columns){
+    for(int col = 0; columns; col++, columns >>= 1){
+        if(!(columns & 1)) continue;
+
+        vector<uint16_t>& cell = gridCells[page][col];
+
+        for(size_t i = 0; i < cell.size(); i++){
+            if(cell[i] == slot){
+                cell[i] = cell.back();
+                cell.pop_back();
+                break;
+            }
+        }
+    }
+}
+
+/// @brief marks every tile a sprite's copies touch to get rebuilt
+static void MarkTilesDirty(const SpriteBoxes& boxes){
+    uint16_t cells[GRID_PAGES];
+    GridCells(boxes, cells);
+
+    for(int page = 0; page < GRID_PAGES; page++) dirtyTiles[page] |= cells[page];
+}
+
+/// @brief a fresh stamp for slotVisited, nothing has been found with it yet
+static uint32_t NewQueryStamp(){
+    if(++queryStamp == 0){
+        fill(slotVisited.begin(), slotVisited.end(), 0);
+        queryStamp = 1;
+    }
+
+    return queryStamp;
+}
+
+/// @brief calls visit with the dense index of every sprite whose box overlaps box and hasn't been found with this
+/// stamp yet, marking each one found
+template <typename Visit>
+static void ForEachOverlapping(const SpriteBox& box, uint32_t stamp, Visit visit){
+    int col0, col1, page0, page1;
+
+    spatialStats.queries++;
+    if(!GridRange(box, col0, col1, page0, page1)) return;
+
+    for(int page = page0; page <= page1; page++){
+        for(int col = col0; col <= col1; col++){
+            spatialStats.cellsVisited++;
+
+            for(uint16_t slot : gridCells[page][col]){
+                if(slotVisited[slot] == stamp) continue;
+
+                spatialStats.candidates++;
+
+                int index = slotDense[slot];
+                if(!OverlapsAny(box, denseBox[index])) continue;
+
+                slotVisited[slot] = stamp;
+                visit(index);
+            }
+        }
+    }
+}
+
+/// @brief where the sprite is in the dense arrays, -1 if it's been removed
+static inline int DenseIndex(SpriteHandle handle){
+    uint32_t slot = handle & 0xFFFF;
+
+    if(slot >= slotGeneration.size() || slotGeneration[slot] != handle >> 16) return -1;
+    return slotDense[slot];
+}
+
+static SpriteHandle AddSprite(const string& name, const sprite_screen_structure& sprite){
+    uint32_t slot;
+
+    if(!freeSlots.empty()){
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }else{
+        slot = slotGeneration.size();
+        slotGeneration.push_back(1);
+        slotDense.push_back(0);
+        slotVisited.push_back(0);
+    }
+
+    SpriteHandle handle = ((uint32_t)slotGeneration[slot] << 16) | slot;
+    slotDense[slot] = denseSprite.size();
+
+    denseHandle.push_back(handle);
+    denseBox.push_back({});
+    denseSprite.push_back(sprite);
+    denseSprite.back().handle = handle;
+    denseSprite.back().sequence = spriteSequence++;
+    denseName.push_back(name);
+
+    spriteNames[name] = handle;
+
+    return handle;
+}
+
+/// @brief takes a sprite out of the registry and gives its bitmap back. Doesn't touch the screen
+static void DropSprite(SpriteHandle handle){
+    int index = DenseIndex(handle);
+    if(index < 0) return;
+
+    FreeSpriteImage(denseSprite[index]);
+    spriteNames.erase(denseName[index]);
+    uint16_t cells[GRID_PAGES];
+    GridCells(denseBox[index], cells);
+    for(int page = 0; page < GRID_PAGES; page++) GridRemove(handle & 0xFFFF, page, cells[page]);
+
+    if(retainedMode) MarkTilesDirty(denseBox[index]);
+
+    int last = denseSprite.size() - 1;
+
+    if(index != last){
+        denseHandle[index] = denseHandle[last];
+        denseBox[index] = denseBox[last];
+        denseSprite[index] = denseSprite[last];
+        denseName[index] = std::move(denseName[last]);
+
+        slotDense[denseHandle[index] & 0xFFFF] = index;
+    }
+
+    denseHandle.pop_back();
+    denseBox.pop_back();
+    denseSprite.pop_back();
+    denseName.pop_back();
+
+    uint32_t slot = handle & 0xFFFF;
+    if(++slotGeneration[slot] == 0) slotGeneration[slot] = 1; // 0 would make handle 0 a real sprite
+    freeSlots.push_back(slot);
+}
+
+/// @brief the bitmap of a sprite replacing one that belongs to scene owner has to end up where ending the scenes
+/// opened since won't reset it away. Reuses the old block if it's the same size class, otherwise moves it under the
+/// mark, the one it came in is given back either way
+/// @return false if there's no room under the mark, replacement keeps its own bitmap then
+static bool KeepImageInScene(sprite_screen_structure& replacement, const sprite_screen_structure& old, uint16_t owner){
+    if(owner >= sceneMarks.size() || !replacement.img) return true; // nothing opened since owns anything
+
+    uint32_t mark = sceneMarks[owner];
+    if(SpriteArenaBelow(replacement.img, replacement.imgBytes, mark)) return true;
+
+    uint8_t *block = nullptr;
+    if(old.img && SpriteArenaBlockBytes(old.imgBytes) == SpriteArenaBlockBytes(replacement.imgBytes)) block = old.img;
+    else block = SpriteArenaAllocBelow(replacement.imgBytes, mark);
+
+    if(!block) return false;
+
+    memcpy(block, replacement.img, replacement.imgBytes);
+    if(block == old.img && old.imgBytes > replacement.imgBytes) memset(block + replacement.imgBytes, 0, old.imgBytes - replacement.imgBytes);
+
+    SpriteArenaFree(replacement.img, replacement.imgBytes);
+    replacement.img = block;
+
+    return true;
+}
+
+/// @brief puts sprite in the registry as name. If there's already one called that it gets replaced, keeping its
+/// handle, its place in the draw order and the scene it belongs to, and its old bitmap goes back. If the new bitmap
+/// can't be kept in that scene's memory the old sprite stays as it is and the new bitmap goes back instead
+static sprite_screen_structure& StoreSprite(const string& name, const sprite_screen_structure& sprite){
+    int index = DenseIndex(FindSpriteHandle(name));
+
+    if(index < 0) return denseSprite[DenseIndex(AddSprite(name, sprite))];
+
+    sprite_screen_structure& stored = denseSprite[index];
+    sprite_screen_structure replacement = sprite;
+
+    if(!KeepImageInScene(replacement, stored, stored.scene)){
+        if(replacement.img != stored.img) FreeSpriteImage(replacement);
+        return stored;
+    }
+
+    SpriteHandle handle = stored.handle;
+    int layer = stored.layer, z = stored.z;
+    uint32_t sequence = stored.sequence;
+    uint16_t scene = stored.scene;
+
+    if(stored.img != replacement.img) FreeSpriteImage(stored);
+    else if(stored.ownMask != replacement.ownMask) FreeSpriteMask(stored);
+    stored = replacement;
+    stored.handle = handle;
+    stored.layer = layer;
+    stored.z = z;
+    stored.sequence = sequence;
+    stored.scene = scene;
+
+    return stored;
+}
+
+/// @brief moves a sprite's boxes, and it in the grid for the cells it left or got to
+static void SetSpriteBox(int index, const SpriteBoxes& boxes){
+    SpriteBoxes& old = denseBox[index];
+
+    if(SameBoxes(old, boxes)) return;
+
+    uint16_t slot = denseHandle[index] & 0xFFFF;
+    uint16_t was[GRID_PAGES], now[GRID_PAGES];
+    GridCells(old, was);
+    GridCells(boxes, now);
+
+    spatialStats.updates++;
+
+    for(int page = 0; page < GRID_PAGES; page++){
+        GridRemove(slot, page, was[page] & ~now[page]);
+        GridInsert(slot, page, now[page] & ~was[page]);
+    }
+
+    old = boxes;
+}
+
+/// @brief the sprite a handle points at, nullptr if it's been removed. The pointer is only good until the next
+/// sprite gets made or removed, hang on to the handle instead
+sprite_screen_structure* GetSprite(SpriteHandle handle){
+    int index = DenseIndex(handle);
+    return index < 0 ? nullptr : &denseSprite[index];
+}
+
+/// @brief the handle for a name, 0 if there's nothing called that
+SpriteHandle FindSpriteHandle(const string& name){
+    auto found = spriteNames.find(name);
+    return found == spriteNames.end() ? 0 : found->second;
+}
+
+sprite_screen_structure* FindSprite(const string& name){
+    return GetSprite(FindSpriteHandle(name));
+}
+
+int GetSpriteCount(){
+    return denseSprite.size();
+}
+
 void DeleteEverything(){
 
-    allSprites.clear();
+    while(!denseHandle.empty()) DropSprite(denseHandle.back());
+
+    // every scene goes with them, new sprites start back in scene 0 with the whole arena
+    sceneMarks.clear();
+    currentScene = 0;
+    SpriteArenaReset(0);
 
     DeleteScreen();
 }
 
 /// @brief blacks out an area without removing any sprites
 void RemoveArea(int xPixelStart, int xPixelEnd, int yPixelStart, int yPixelEnd){
-
-    for(int i = xPixelStart; i < xPixelEnd; i++){
-        for(int j = yPixelStart; j < yPixelEnd; j++){ 
-            SetPixel(bufferGlobal, i, j, false); 
-        } 
-    } 
+    FillRect(bufferGlobal, xPixelStart, yPixelStart, xPixelEnd - xPixelStart, yPixelEnd - yPixelStart, false);
 }
 
 /// @brief returns true if a position within the global hex is
@@ -202,162 +607,820 @@ bool IsWithinScreen(Vector2 position, sprite_screen_structure &sprite){
 
 
 
-/// @brief draws a sprite to the global buffer. Currently no way to have 'uneven' wrap arounds (so if you go over 56 you wrap to 12, but the reverse takes you to 118, for example)
-/// @param sprite 
-/// @param wraparoundValueUnder the value we go to when we go OVER the max, so above wraparoundValueOver
-/// @param wraparoundValueOver the value we go to when we go under the minimum, so below wraparundValueUnder
-void DrawToGlobalBackend(sprite_screen_structure& sprite, int drawOrErase, bool wrapAround, Vector2 wraparoundValueUnder, Vector2 wraparoundValueOver)
+// Clip rects. The blitter only ever touches what's inside the top one, pushing a rect intersects it with the one
+// under it, so nothing can end up bigger than the screen. Empty stack means the whole screen
+vector<ClipRect> clipStack = {};
+
+/// @brief everything drawn after this only lands inside x/y/width/height (and whatever was pushed before it)
+void PushClipRect(int x, int y, int width, int height){
+    ClipRect top = GetClipRect();
+
+    ClipRect clip = {
+        max(x, top.x0),
+        max(y, top.y0),
+        min(x + width, top.x1),
+        min(y + height, top.y1)
+    };
+
+    //an empty rect is still a rect, it just clips everything
+    if(clip.x1 < clip.x0) clip.x1 = clip.x0;
+    if(clip.y1 < clip.y0) clip.y1 = clip.y0;
+
+    clipStack.push_back(clip);
+}
+
+void PopClipRect(){
+    if(!clipStack.empty()) clipStack.pop_back();
+}
+
+ClipRect GetClipRect(){
+    if(clipStack.empty()) return {0, 0, 128, 64};
+    return clipStack.back();
+}
+
+static inline ClipRect IntersectClip(ClipRect a, ClipRect b){
+    ClipRect clip = {max(a.x0, b.x0), max(a.y0, b.y0), min(a.x1, b.x1), min(a.y1, b.y1)};
+    if(clip.x1 < clip.x0) clip.x1 = clip.x0;
+    if(clip.y1 < clip.y0) clip.y1 = clip.y0;
+    return clip;
+}
+
+/// @brief puts a coordinate back inside [low, high) the toroidal way, so one past the end is the start again
+static inline float WrapCoord(float value, float low, float high){
+    float span = high - low;
+    if(span <= 0) return value;
+
+    float wrapped = fmod(value - low, span);
+    if(wrapped < 0) wrapped += span;
+    return low + wrapped;
+}
+
+/// @brief combines sprite bits into a screen byte. mask is the bits the sprite covers, src the sprite's own bits.
+/// Erasing undoes what drawing did as far as that's possible: OR clears its bits, XOR flips them back, MASKED
+/// clears the whole mask and AND turns back on what it turned off
+static inline uint8_t Blend(uint8_t dst, uint8_t src, uint8_t mask, BlendMode mode, bool draw){
+    switch(mode){
+        case BLEND_AND:
+            return draw ? dst & (src | ~mask) : dst | (mask & ~src);
+        case BLEND_XOR:
+            return dst ^ src;
+        case BLEND_MASKED:
+            return draw ? (dst & ~mask) | (src & mask) : dst & ~mask;
+        case BLEND_OR:
+        default:
+            return draw ? dst | src : dst & ~src;
+    }
+}
+
+// Rotation cache. Rotated bitmaps get built the first time a sprite is drawn at an angle and kept, keyed by a hash
+// of the source image and the angle, so a spinning sprite only pays for each angle once. Angles get snapped to
+// rotationSteps per full turn, and the least recently used one goes when it's full
+struct RotationCacheEntry
 {
-    int modulo = (int)sprite.pos.y % 8; // where we are on the current page we're starting ons
-  
-    int hexSprite = 0; // counter for what hex in the array we're in
-    int globalBitPosition = modulo; // counter for what bit position in the global buffers target hex we are editing
+    uint64_t key;
+    int width, height;
+    vector<uint8_t> img;
+    vector<uint8_t> mask; // empty if the source didn't have one
+
+    // what it was built from, the key is only a hash so a hit gets checked against these
+    int sourceWidth, sourceHeight;
+    bool sourceMasked;
+    vector<uint8_t> source; // the unrotated image, then the mask if there is one
+};
 
-    int extraTracker = 0; //This could also be worked out the loop values but its easier to just have yet another counter variable
-    for (int x = sprite.pos.x; x < sprite.pos.x + sprite.size.x; x++)
-    {
+list<RotationCacheEntry> rotationCache = {}; // most recently used at the front
+unordered_map<uint64_t, list<RotationCacheEntry>::iterator> rotationIndex = {};
+int rotationCacheCapacity = 8;
+int rotationSteps = 64;
+RotationCacheStats rotationStats = {};
+
+/// @brief snaps an angle to the nearest rotation step, in 0 to 360
+static float SnapRotation(float degrees){
+    int step = (int)lround(degrees * rotationSteps / 360.0f) % rotationSteps;
+    if(step < 0) step += rotationSteps;
+    return step * 360.0f / rotationSteps;
+}
+
+/// @brief the box a w x h image needs once it's rotated, the exact swap at 90 and 270
+static void RotatedSize(int width, int height, float degrees, int& outWidth, int& outHeight){
+    float rads = degrees * (float)M_PI / 180.0f;
+    float c = fabs(cos(rads)), s = fabs(sin(rads));
+
+    outWidth = max(1, (int)ceil(width * c + height * s - 0.01f));
+    outHeight = max(1, (int)ceil(width * s + height * c - 0.01f));
+}
+
+/// @brief nearest neighbour rotation about the centre. Goes the other way, for every pixel of the output it works
+/// out which source pixel lands there, stepping down each column in 16.16 fixed point
+static void RotateBitmap(const uint8_t *src, int width, int height, float degrees, vector<uint8_t>& out, int outWidth, int outHeight){
+    out.assign(outWidth * ((outHeight + 7) / 8), 0);
+
+    // quarter turns are exact, so they go through the transpose instead
+    if(degrees == 90 || degrees == 270){
+        (degrees == 90 ? RotateBitmap90 : RotateBitmap270)(src, out.data(), width, height);
+        return;
+    }else if(degrees == 180){
+        memcpy(out.data(), src, out.size());
+        RotateBitmap180(out.data(), width, height);
+        return;
+    }
 
-        int xTracker = 0; //bit tracker for sprite
-        globalBitPosition = modulo; 
-        hexSprite = extraTracker;
+    float rads = degrees * (float)M_PI / 180.0f;
+    float c = cos(rads), s = sin(rads);
 
-        int xTemp = x;
+    int32_t stepX = (int32_t)lround(s * 65536), stepY = (int32_t)lround(c * 65536);
 
-        if(wrapAround && x >= wraparoundValueOver.x){
-            xTemp = x - wraparoundValueOver.x;
-        }else if(wrapAround && x <= wraparoundValueUnder.x){
-            xTemp = x + wraparoundValueOver.x;
+    for(int x = 0; x < outWidth; x++){
+        float dx = x + 0.5f - outWidth / 2.0f;
+        float dy = 0.5f - outHeight / 2.0f;
+
+        int32_t sx = (int32_t)lround((c * dx + s * dy + width / 2.0f) * 65536);
+        int32_t sy = (int32_t)lround((-s * dx + c * dy + height / 2.0f) * 65536);
+
+        for(int y = 0; y < outHeight; y++, sx += stepX, sy += stepY){
+            int ix = sx >> 16, iy = sy >> 16;
+            if(ix < 0 || ix >= width || iy < 0 || iy >= height) continue;
+
+            if((src[(iy >> 3) * width + ix] >> (iy & 7)) & 1) out[(y >> 3) * outWidth + x] |= 1 << (y & 7);
         }
+    }
+}
+
+/// @brief FNV-1a over the size and the image (and mask), never 0 as that means it hasn't been worked out yet
+static uint32_t HashSprite(const sprite_screen_structure& sprite){
+    int width = (int)sprite.size.x, bytes = width * (((int)sprite.size.y + 7) / 8);
+    uint32_t hash = 2166136261u;
+
+    auto add = [&hash](uint8_t byte){ hash = (hash ^ byte) * 16777619u; };
+
+    add(width); add((int)sprite.size.y);
+    for(int i = 0; i < bytes; i++) add(sprite.img[i]);
+    if(sprite.mask) for(int i = 0; i < bytes; i++) add(sprite.mask[i]);
+
+    return hash ? hash : 1;
+}
+
+static inline size_t EntryBytes(const RotationCacheEntry& entry){
+    return entry.img.size() + entry.mask.size() + entry.source.size();
+}
+
+static void DropRotated(list<RotationCacheEntry>::iterator entry){
+    rotationStats.bytes -= EntryBytes(*entry);
+    rotationIndex.erase(entry->key);
+    rotationCache.erase(entry);
+}
 
-        for (int y = sprite.pos.y; y < sprite.pos.y + sprite.size.y; y++) //so loop through every bit
+/// @brief true if the entry really was built from this sprite's image and mask, not just one that hashes the same
+static bool SameSource(const RotationCacheEntry& entry, const sprite_screen_structure& sprite){
+    int width = (int)sprite.size.x, height = (int)sprite.size.y;
+    size_t bytes = width * ((height + 7) / 8);
+
+    if(entry.sourceWidth != width || entry.sourceHeight != height || entry.sourceMasked != (sprite.mask != nullptr)) return false;
+    if(memcmp(entry.source.data(), sprite.img, bytes)) return false;
+
+    return !sprite.mask || !memcmp(entry.source.data() + bytes, sprite.mask, bytes);
+}
+
+/// @brief finds (or builds) the sprite rotated by an already snapped angle
+static const RotationCacheEntry& GetRotated(sprite_screen_structure& sprite, float degrees){
+    if(!sprite.sourceKey) sprite.sourceKey = HashSprite(sprite);
+
+    uint64_t key = ((uint64_t)sprite.sourceKey << 32) | (uint32_t)lround(degrees * 100);
+
+    auto found = rotationIndex.find(key);
+    if(found != rotationIndex.end()){
+        if(SameSource(*found->second, sprite)){
+            rotationStats.hits++;
+            rotationCache.splice(rotationCache.begin(), rotationCache, found->second);
+            return rotationCache.front();
+        }
+
+        DropRotated(found->second); // a different sprite that happens to hash the same, this one gets the key now
+    }
+
+    rotationStats.misses++;
+
+    while(!rotationCache.empty() && (int)rotationCache.size() >= rotationCacheCapacity){
+        DropRotated(prev(rotationCache.end()));
+    }
+
+    int bytes = (int)sprite.size.x * (((int)sprite.size.y + 7) / 8);
+
+    RotationCacheEntry entry;
+    entry.key = key;
+    entry.sourceWidth = (int)sprite.size.x;
+    entry.sourceHeight = (int)sprite.size.y;
+    entry.sourceMasked = sprite.mask != nullptr;
+    entry.source.assign(sprite.img, sprite.img + bytes);
+    if(sprite.mask) entry.source.insert(entry.source.end(), sprite.mask, sprite.mask + bytes);
+
+    RotatedSize((int)sprite.size.x, (int)sprite.size.y, degrees, entry.width, entry.height);
+    RotateBitmap(sprite.img, (int)sprite.size.x, (int)sprite.size.y, degrees, entry.img, entry.width, entry.height);
+    if(sprite.mask) RotateBitmap(sprite.mask, (int)sprite.size.x, (int)sprite.size.y, degrees, entry.mask, entry.width, entry.height);
+
+    rotationStats.bytes += EntryBytes(entry);
+
+    rotationCache.push_front(std::move(entry));
+    rotationIndex[key] = rotationCache.begin();
+
+    return rotationCache.front();
+}
+
+/// @brief how many steps a full turn gets snapped to, more looks smoother but fills the cache faster
+void SetRotationSteps(int stepsPerTurn){
+    if(stepsPerTurn < 1) stepsPerTurn = 1;
+    rotationSteps = stepsPerTurn;
+}
+
+/// @brief how many rotated bitmaps get kept, dropping the least recently used ones if it's shrinking
+void SetRotationCacheSize(int entries){
+    rotationCacheCapacity = max(1, entries);
+
+    while((int)rotationCache.size() > rotationCacheCapacity){
+        DropRotated(prev(rotationCache.end()));
+    }
+}
+
+void ClearRotationCache(){
+    rotationCache.clear();
+    rotationIndex.clear();
+    rotationStats.bytes = 0;
+}
+
+RotationCacheStats GetRotationCacheStats(){
+    RotationCacheStats stats = rotationStats;
+    stats.entries = rotationCache.size();
+    return stats;
+}
+
+/// @brief how big something w x h comes out at a 16.16 scale, never less than a pixel
+static inline int ScaledLength(int length, int32_t scale){
+    return max(1, (int)(((int64_t)length * scale + (1 << 15)) >> 16));
+}
+
+/// @brief where the sprite actually is on screen with its scale and rotation. Scaling keeps the top left at pos,
+/// rotated ones stay centred on where the scaled unrotated one would be
+static void DrawnBounds(const sprite_screen_structure& sprite, Vector2& pos, Vector2& size){
+    pos = sprite.pos;
+    size = sprite.size;
+
+    if(sprite.drawnRotation == 0 && sprite.drawnScale == 1 << 16) return;
+
+    int width = (int)sprite.size.x, height = (int)sprite.size.y;
+    if(sprite.drawnRotation != 0) RotatedSize((int)sprite.size.x, (int)sprite.size.y, sprite.drawnRotation, width, height);
+
+    width = ScaledLength(width, sprite.drawnScale);
+    height = ScaledLength(height, sprite.drawnScale);
+
+    pos.x = (int)sprite.pos.x + (ScaledLength((int)sprite.size.x, sprite.drawnScale) - width) / 2;
+    pos.y = (int)sprite.pos.y + (ScaledLength((int)sprite.size.y, sprite.drawnScale) - height) / 2;
+    size = {(float)width, (float)height};
+}
+
+// what actually gets blitted, either a sprite's own img or a rotated one out of the cache
+struct SpriteBitmap
+{
+    const uint8_t *img;
+    const uint8_t *mask;
+    int width, height;
+};
+
+/// @brief blits one copy of a sprite at posX/posY, only touching what's inside clip (which has to be on screen).
+/// Works a whole sprite byte at a time. Each byte is 8 rows of one column, so it gets shifted down by posY % 8 and
+/// split across the two pages it lands on, then blended in with the sprite's blend mode. Sprites completely inside
+/// the clip skip all the masking, sprites completely outside don't get looked at
+static void BlitClipped(const SpriteBitmap& bitmap, BlendMode mode, int posX, int posY, ClipRect clip, bool draw)
+{
+    int width = bitmap.width;
+    int height = bitmap.height;
+
+    if(clip.x1 <= clip.x0 || clip.y1 <= clip.y0) return; // an empty clip can sit past the screen edge
+    if(posX >= clip.x1 || posX + width <= clip.x0 || posY >= clip.y1 || posY + height <= clip.y0) return;
+
+    bool inside = posX >= clip.x0 && posX + width <= clip.x1 && posY >= clip.y0 && posY + height <= clip.y1;
+
+    int shift = posY & 7; // where we are on the page we're starting on
+    int firstPage = posY >> 3; // rounds down for negatives too
+
+    // only the columns and sprite byte rows that can land inside the clip
+    int colStart = max(0, clip.x0 - posX);
+    int colEnd = min(width, clip.x1 - posX);
+    int kStart = max(0, (clip.y0 - posY) >> 3);
+    int kEnd = min((height + 7) / 8, (clip.y1 - posY + 7) >> 3);
+
+    // rows of each page inside the clip, offset by one so page -1 (the top half of a byte that starts above the
+    // screen) and page 8 can be looked up without a bounds check
+    uint8_t pageClip[10] = {0};
+    if(!inside){
+        for(int page = 0; page < 8; page++){
+            int top = max(page * 8, clip.y0), bottom = min(page * 8 + 8, clip.y1);
+            if(top < bottom) pageClip[page + 1] = (uint8_t)(((1 << (bottom - top)) - 1) << (top - page * 8));
+        }
+    }
+
+    // OR and XOR only ever touch the sprite's set bits, AND and MASKED touch everything they cover
+    bool touchesClearBits = (mode == BLEND_AND || mode == BLEND_MASKED);
+
+    for (int col = colStart; col < colEnd; col++)
+    {
+        int x = posX + col;
+
+        int lowPage = 8, highPage = -1; //pages this column touched, for the dirty tracking
+
+        for (int k = kStart; k < kEnd; k++)
         {
-            int yTemp = y;
+            int rows = height - k * 8 < 8 ? height - k * 8 : 8;
+            uint8_t valid = (uint8_t)((1 << rows) - 1);
+
+            uint8_t bits = bitmap.img[k * width + col] & valid;
+            uint8_t mask = valid;
+            if(mode == BLEND_MASKED && bitmap.mask) mask = bitmap.mask[k * width + col] & valid;
+
+            uint8_t touched = touchesClearBits ? mask : bits;
+            if(!touched) continue;
 
-            if(wrapAround && y >= wraparoundValueOver.y){
-                yTemp = y - wraparoundValueOver.y;
-            }else if(wrapAround && y <= wraparoundValueUnder.y){
-                yTemp = y + wraparoundValueOver.y;
+            int page = firstPage + k;
+
+            // the part that lands on this page, and the part that spills onto the next one
+            uint8_t upperMask = touched << shift;
+            uint8_t lowerMask = shift ? touched >> (8 - shift) : 0;
+
+            if(!inside){
+                upperMask &= pageClip[page + 1];
+                lowerMask &= pageClip[page + 2];
             }
 
+            if(upperMask){
+                uint8_t &dst = bufferGlobal[page * 128 + x];
+                dst = Blend(dst, (uint8_t)(bits << shift) & upperMask, upperMask, mode, draw);
 
-            if(xTracker > 7){ //we've counted up 8 bits, time to go to the next vertical hex in the sprite
-                hexSprite+=sprite.size.x; //the downside of doing x then y is this awkward stuff, but this takes us to the next vertical hex
-                xTracker = 0; //reset the counter
+                if(page < lowPage) lowPage = page;
+                if(page > highPage) highPage = page;
             }
 
-            int globalPosition = (((yTemp - (yTemp % 8)) / 8) * 128) + xTemp; //global position in the global hex array
+            if(lowerMask){
+                uint8_t &dst = bufferGlobal[(page + 1) * 128 + x];
+                dst = Blend(dst, (uint8_t)(bits >> (8 - shift)) & lowerMask, lowerMask, mode, draw);
 
+                if(page + 1 < lowPage) lowPage = page + 1;
+                if(page + 1 > highPage) highPage = page + 1;
+            }
+        }
 
-            //now we know which hexes we are working with on this bit, we get the actual bits
+        if(highPage >= 0) MarkDirty(x, x, lowPage, highPage);
+    }
+}
 
-            //we're looping through each bit, that means we edit each hex based purely off positional data
-            if(y % 8 == 0){ //we're about to go over into the next page, reset the counter.
-                globalBitPosition = 0;
+/// @brief blits a bitmap stretched (or squashed) to drawWidth x drawHeight, nearest neighbour, clipped like
+/// BlitClipped. There's no scaled copy anywhere, each destination column picks its source column, then every
+/// destination page byte gets each of its rows picked straight out of that column's source bytes, so the bitmap can
+/// be any height
+static void BlitScaled(const SpriteBitmap& bitmap, BlendMode mode, int posX, int posY, int drawWidth, int drawHeight, ClipRect clip, bool draw)
+{
+    int x0 = max(posX, clip.x0), x1 = min(posX + drawWidth, clip.x1);
+    int y0 = max(posY, clip.y0), y1 = min(posY + drawHeight, clip.y1);
+
+    if(x0 >= x1 || y0 >= y1) return;
+
+    int width = bitmap.width, height = bitmap.height;
+
+    // which source row each screen row samples, from the middle of the destination pixel
+    int sourceRow[64];
+    for(int y = y0; y < y1; y++){
+        sourceRow[y] = (int)(((int64_t)(y - posY) * 2 + 1) * height / (drawHeight * 2));
+    }
+
+    bool touchesClearBits = (mode == BLEND_AND || mode == BLEND_MASKED);
+    const uint8_t *maskBytes = (mode == BLEND_MASKED) ? bitmap.mask : nullptr;
+
+    for(int x = x0; x < x1; x++){
+        int sx = (int)(((int64_t)(x - posX) * 2 + 1) * width / (drawWidth * 2));
+
+        int lowPage = 8, highPage = -1;
+
+        for(int page = y0 >> 3; page <= (y1 - 1) >> 3; page++){
+            uint8_t bits = 0, mask = 0;
+            int top = max(page * 8, y0), bottom = min(page * 8 + 8, y1);
+
+            for(int y = top; y < bottom; y++){
+                int sy = sourceRow[y];
+                int at = (sy >> 3) * width + sx;
+
+                uint8_t bit = (bitmap.img[at] >> (sy & 7)) & 1;
+                uint8_t covered = bit;
+                if(touchesClearBits) covered = maskBytes ? (maskBytes[at] >> (sy & 7)) & 1 : 1;
+
+                bits |= bit << (y & 7);
+                mask |= covered << (y & 7);
             }
 
+            if(!mask) continue;
+
+            uint8_t &dst = bufferGlobal[page * 128 + x];
+            dst = Blend(dst, bits & mask, mask, mode, draw);
+
+            if(page < lowPage) lowPage = page;
+            if(page > highPage) highPage = page;
+        }
+
+        if(highPage >= 0) MarkDirty(x, x, lowPage, highPage);
+    }
+}
+
+// Draw order. Lower layers go on first, then lower z inside a layer, then whichever was made first, so two sprites
+// always end up the same way round. Whenever a registered sprite gets drawn or erased only the box it covers gets
+// put back together: it's cleared and everything in there gets redrawn clipped to it, in draw order, XOR ones
+// included. Anything outside the box doesn't get touched, however much it overlaps something inside it
+static inline bool DrawsBefore(const sprite_screen_structure& a, const sprite_screen_structure& b){
+    if(a.layer != b.layer) return a.layer < b.layer;
+    if(a.z != b.z) return a.z < b.z;
+    return a.sequence < b.sequence;
+}
+
+bool recomposing = false; // the redraws for putting an area back leave what each sprite covers alone
+
+/// @brief redraws the sprites at those dense indexes clipped to area, in draw order. The area has to have been
+/// cleared first, otherwise XOR ones flip back off
+static void Recomposite(vector<int>& indexes, const SpriteBox& area){
+    if(indexes.empty()) return;
+
+    spatialStats.redrawn += indexes.size();
+    sort(indexes.begin(), indexes.end(), [](int a, int b){ return DrawsBefore(denseSprite[a], denseSprite[b]); });
+
+    PushClipRect(area.x0, area.y0, area.x1 - area.x0, area.y1 - area.y0);
+    recomposing = true;
 
-            /*
-            EXPLANATION FOR HOW BITWISE OPERATORS WORK FOR LATER
-            This line: 
-            
-            bool bitValue = (sprite.img[hexSprite] >> xTracker) & 1;
+    for(int i : indexes){
+        sprite_screen_structure& spr = denseSprite[i];
+        DrawToGlobal(spr, 1, spr.wrapAround, spr.wrapMin, spr.wrapMax);
+    }
+
+    recomposing = false;
+    PopClipRect();
+}
+
+/// @brief the bits of page that rows y0 up to (not including) y1 cover
+static inline uint8_t PageRows(int page, int y0, int y1){
+    int lo = max(y0 - page * 8, 0), hi = min(y1 - page * 8, 8);
+    return hi > lo ? (uint8_t)(((1u << hi) - 1) & ~((1u << lo) - 1)) : 0;
+}
+
+/// @brief area cut down to the screen
+static SpriteBox OnScreen(const SpriteBox& area){
+    return {max(area.x0, 0), max(area.y0, 0), min(area.x1, 128), min(area.y1, GRID_PAGES * 8)};
+}
 
-            means we take sprite.img[hexSprite], and move all the bits to the right by xTracker, replacing the left bits with 0's
-            then compares the new hex with 1 (00000001), and returns true if ANY of the bits in the same position for both hexes is 1, which because 
-            1 is 00000001 can only be the last bit after shifting the bits right
-            */
-            // if(sp->pos.y > wraparoundValueOver.y) sp->pos.y = wraparoundValueUnder.y;
-            // if(sp->pos.y < wraparoundValueUnder.y) sp->pos.y = wraparoundValueOver.y;
+/// @brief copies the pixels of area that no sprite's box covers yet out of bufferGlobal into spriteBackground, call
+/// it before a box grows over them. Pixels some box already covers keep what was saved when that box got there
+static void SaveBackground(const SpriteBox& area){
+    SpriteBox screen = OnScreen(area);
+    if(screen.x1 <= screen.x0 || screen.y1 <= screen.y0) return;
 
+    vector<int> covering;
+    ForEachOverlapping(screen, NewQueryStamp(), [&](int other){ covering.push_back(other); });
 
-            bool bitValue = (sprite.img[hexSprite] >> xTracker) & 1; //and the bit in the SPRITES hex we are putting in
+    uint8_t uncovered[128];
 
-            if (bitValue) {
-                if (drawOrErase) {
-                    bufferGlobal[globalPosition] |= (1 << globalBitPosition); // Set bit
-                } else {
-                    bufferGlobal[globalPosition] &= ~(1 << globalBitPosition); // Clear bit
-                }
+    for(int page = screen.y0 >> 3; page <= (screen.y1 - 1) >> 3; page++){
+        uint8_t rows = PageRows(page, screen.y0, screen.y1);
+        fill(uncovered + screen.x0, uncovered + screen.x1, rows);
+
+        for(int other : covering){
+            for(int i = 0; i < denseBox[other].count; i++){
+                const SpriteBox& box = denseBox[other].box[i];
+                uint8_t covered = PageRows(page, box.y0, box.y1) & rows;
+                if(!covered) continue;
+
+                for(int x = max(screen.x0, box.x0); x < min(screen.x1, box.x1); x++) uncovered[x] &= ~covered;
             }
+        }
+
+        for(int x = screen.x0; x < screen.x1; x++){
+            uint8_t bits = uncovered[x];
+            if(!bits) continue;
+
+            uint8_t& saved = spriteBackground[page * 128 + x];
+            saved = (saved & ~bits) | (bufferGlobal[page * 128 + x] & bits);
+        }
+    }
+}
 
+/// @brief puts back what's under area and redraws every sprite on screen that overlaps it, clipped to it. The box
+/// has to be covered by registered boxes (or have been until now), so its background has been saved
+static void RebuildArea(const SpriteBox& area){
+    SpriteBox screen = OnScreen(area);
+    if(screen.x1 <= screen.x0 || screen.y1 <= screen.y0) return;
 
-            xTracker++;
-            globalBitPosition++;
+    vector<int> overlaps;
+    ForEachOverlapping(screen, NewQueryStamp(), [&](int other){ overlaps.push_back(other); });
 
-        } // vertical
-        extraTracker++;
+    for(int page = screen.y0 >> 3; page <= (screen.y1 - 1) >> 3; page++){
+        uint8_t rows = PageRows(page, screen.y0, screen.y1);
+
+        for(int x = screen.x0; x < screen.x1; x++){
+            uint8_t& pixel = bufferGlobal[page * 128 + x];
+            pixel = (pixel & ~rows) | (spriteBackground[page * 128 + x] & rows);
+        }
     }
 
+    MarkDirtyPixels(screen.x0, screen.x1 - 1, screen.y0, screen.y1 - 1);
+    Recomposite(overlaps, screen);
 }
 
-void DrawToGlobal(sprite_screen_structure& sprite, int drawOrErase, bool wrapAround, Vector2 wraparoundValueUnder, Vector2 wraparoundValueOver){
-    DrawToGlobalBackend(sprite, drawOrErase, wrapAround, wraparoundValueUnder, wraparoundValueOver);
+/// @brief rebuilds every dirty tile from nothing: clears it, then draws everything touching it in draw order clipped
+/// to the tile. The rebuilt tiles get marked dirty with the driver, a run of them at a time, so the next flush sends
+/// those and nothing else. Update() calls this in retained mode, you only need it if you flush some other way
+/// @return how many tiles got rebuilt
+int ComposeDirtyTiles(){
+    int composed = 0;
+    vector<int> touching;
+
+    for(int page = 0; page < GRID_PAGES; page++){
+        uint16_t dirty = dirtyTiles[page];
+        if(!dirty) continue;
+
+        dirtyTiles[page] = 0;
+
+        for(int col = 0; col < GRID_COLUMNS; col++){
+            if(!((dirty >> col) & 1)) continue;
+
+            int x = col * GRID_BUCKET_WIDTH;
+            memset(bufferGlobal + page * 128 + x, 0, GRID_BUCKET_WIDTH);
+
+            touching.clear();
+            for(uint16_t slot : gridCells[page][col]) touching.push_back(slotDense[slot]);
+
+            Recomposite(touching, {x, page * 8, x + GRID_BUCKET_WIDTH, page * 8 + 8});
+            composed++;
+        }
+
+        for(int col = 0; col < GRID_COLUMNS;){
+            if(!((dirty >> col) & 1)){
+                col++;
+                continue;
+            }
+
+            int end = col;
+            while(end + 1 < GRID_COLUMNS && ((dirty >> (end + 1)) & 1)) end++;
+
+            MarkDirty(col * GRID_BUCKET_WIDTH, end * GRID_BUCKET_WIDTH + GRID_BUCKET_WIDTH - 1, page, page);
+            col = end + 1;
+        }
+    }
+
+    return composed;
 }
 
+/// @brief switches between drawing sprites as they change (the default) and retained mode, where changes just mark
+/// tiles and Update() rebuilds them. Turning it on rebuilds the whole screen on the next frame, turning it off
+/// rebuilds whatever was waiting first. Anything drawn straight into bufferGlobal gets wiped when its tile is rebuilt,
+/// so in retained mode put everything on screen in a sprite
+void SetRetainedMode(bool on){
+    if(on == retainedMode) return;
+
+    if(on){
+        fill(dirtyTiles, dirtyTiles + GRID_PAGES, 0xFFFF);
+    }else{
+        ComposeDirtyTiles();
+        memset(spriteBackground, 0, sizeof spriteBackground); // every tile's been rebuilt from nothing, so that's what's under them
+    }
 
-/// @brief This finds every sprite thats touching every other sprite from the original sprite, recursively. 
+    retainedMode = on;
+}
+
+bool GetRetainedMode(){
+    return retainedMode;
+}
+
+/// @brief draws a sprite to the global buffer, clipped to the current clip rect.
+/// With wrapAround the area from wraparoundValueUnder up to (not including) wraparoundValueOver is a torus, so whatever
+/// goes off one side comes back on the other. The sprite gets blitted once per place it shows up, each one clipped to
+/// the area. Erasing always uses the wrap and rotation the sprite was last drawn with, whatever gets passed in, so
+/// it undoes exactly what was drawn. Anything with a rotation gets drawn from the rotation cache, anything with a
+/// scale gets sampled straight out of its bitmap. Registered sprites don't get blitted straight on, drawing or
+/// erasing one puts back what was under the box it covers and redraws it in draw order (or in retained mode just
+/// marks its tiles)
 /// @param sprite 
-/// @param overlaps 
-void FindAllOverlap(sprite_screen_structure& sprite, unordered_set<sprite_screen_structure*>& overlaps){
+/// @param drawOrErase 1 to draw, 0 to undo a draw
+/// @param wraparoundValueUnder top left corner of the wrap area
+/// @param wraparoundValueOver bottom right corner of the wrap area, one past the last pixel
+void DrawToGlobalBackend(sprite_screen_structure& sprite, int drawOrErase, bool wrapAround, Vector2 wraparoundValueUnder, Vector2 wraparoundValueOver)
+{
+    if(!sprite.img) return; // never got a bitmap, the arena was full or it was made by looking up a missing name
+
+    if(drawOrErase && !recomposing){
+        sprite.wrapAround = wrapAround;
+        sprite.wrapMin = wraparoundValueUnder;
+        sprite.wrapMax = wraparoundValueOver;
+        sprite.drawnRotation = SnapRotation(sprite.rotation);
+        sprite.drawnScale = (int32_t)lround((sprite.scale > 0 ? sprite.scale : 1) * 65536);
+    }
 
-    //loop every sprite on the screen, and if they're in bounds add them to the list
- 
-    for(auto& sp : allSprites){
-        bool next = false;
-        if(IsBoundsWithinBounds(sprite, sp.second)){
-            if (overlaps.insert(&sp.second).second) {
-                FindAllOverlap(sp.second, overlaps);
+    // registered sprites remember what they cover so overlaps can be found without looking at the sprites
+    int index = DenseIndex(sprite.handle);
+    bool registered = !recomposing && index >= 0 && &denseSprite[index] == &sprite;
+
+    SpriteBitmap bitmap = {sprite.img, sprite.mask, (int)sprite.size.x, (int)sprite.size.y};
+
+    if(!registered && sprite.drawnRotation != 0){ // registered ones only get blitted by the rebuild
+        const RotationCacheEntry& rotated = GetRotated(sprite, sprite.drawnRotation);
+        bitmap = {rotated.img.data(), rotated.mask.empty() ? nullptr : rotated.mask.data(), rotated.width, rotated.height};
+    }
+
+    Vector2 pos, size;
+    DrawnBounds(sprite, pos, size);
+
+    ClipRect clip = GetClipRect();
+    int posX = (int)pos.x;
+    int posY = (int)pos.y;
+    int drawWidth = (int)size.x, drawHeight = (int)size.y;
+    bool scaled = sprite.drawnScale != 1 << 16;
+
+    SpriteBoxes boxes = {}; // where each copy landed
+
+    auto blit = [&](int x, int y, ClipRect area){
+        if(registered){} // only the box, what it covers gets rebuilt below
+        else if(scaled) BlitScaled(bitmap, sprite.blend, x, y, drawWidth, drawHeight, area, drawOrErase);
+        else BlitClipped(bitmap, sprite.blend, x, y, area, drawOrErase);
+
+        ClipRect hit = IntersectClip(area, {x, y, x + drawWidth, y + drawHeight});
+        if(hit.x1 <= hit.x0 || hit.y1 <= hit.y0) return;
+
+        if(boxes.count < MAX_SPRITE_COPIES){
+            boxes.box[boxes.count++] = {hit.x0, hit.y0, hit.x1, hit.y1};
+        }else{
+            // only a sprite bigger than its wrap area gets here, its copies cover the area anyway
+            SpriteBox& last = boxes.box[MAX_SPRITE_COPIES - 1];
+            last = {min(last.x0, hit.x0), min(last.y0, hit.y0), max(last.x1, hit.x1), max(last.y1, hit.y1)};
+        }
+    };
+
+    int minX = (int)sprite.wrapMin.x, minY = (int)sprite.wrapMin.y;
+    int spanX = (int)sprite.wrapMax.x - minX, spanY = (int)sprite.wrapMax.y - minY;
+
+    if(!sprite.wrapAround || spanX <= 0 || spanY <= 0){
+        blit(posX, posY, clip);
+    }else{
+        clip = IntersectClip(clip, {minX, minY, minX + spanX, minY + spanY});
+
+        // move it into the area, then every copy that pokes into it is one span further back
+        posX = minX + ((posX - minX) % spanX + spanX) % spanX;
+        posY = minY + ((posY - minY) % spanY + spanY) % spanY;
+
+        for(int x = posX; x + drawWidth > minX; x -= spanX){
+            for(int y = posY; y + drawHeight > minY; y -= spanY){
+                blit(x, y, clip);
             }
         }
     }
+
+    if(!registered) return;
+
+    SpriteBoxes old = denseBox[index];
+    if(!drawOrErase) boxes.count = 0;
+
+    if(!retainedMode){
+        for(int i = 0; i < boxes.count; i++) SaveBackground(boxes.box[i]);
+    }
+
+    SetSpriteBox(index, boxes);
+
+    if(retainedMode){
+        MarkTilesDirty(old);
+        MarkTilesDirty(boxes);
+        return;
+    }
+
+    // where it was and where it is now, the sprite itself only shows up in the second
+    for(int i = 0; i < old.count; i++) RebuildArea(old.box[i]);
+
+    if(!SameBoxes(old, boxes)){
+        for(int i = 0; i < boxes.count; i++) RebuildArea(boxes.box[i]);
+    }
 }
 
-/// @brief figure out if the sprite being sent is hitting anything else, nuke anything being touched, and redraw them
-void RemoveSpriteFromGlobalLoop(string name, bool wrapAround = false, Vector2 wraparoundValueUnder = {0,0}, Vector2 wraparoundValueOver = {128,64})
+/// @brief draws (or erases) a sprite that isn't necessarily in the list. Nothing wraps unless you ask it to
+void DrawToGlobal(sprite_screen_structure& sprite, int drawOrErase, bool wrapAround, Vector2 wraparoundValueUnder, Vector2 wraparoundValueOver){
+    DrawToGlobalBackend(sprite, drawOrErase, wrapAround, wraparoundValueUnder, wraparoundValueOver);
+}
+
+
+/// @brief every sprite drawn over the pixel at x/y
+int FindSpritesAt(int x, int y, vector<SpriteHandle>& found){
+    return FindSpritesInRect(x, y, 1, 1, found);
+}
+
+/// @brief every sprite drawn anywhere in the rect. Goes off what's on screen, so sprites that have been taken off
+/// with RemoveSpriteFromGlobal don't count
+int FindSpritesInRect(int x, int y, int width, int height, vector<SpriteHandle>& found){
+    found.clear();
+    ForEachOverlapping({x, y, x + width, y + height}, NewQueryStamp(), [&](int index){ found.push_back(denseHandle[index]); });
+    return found.size();
+}
+
+/// @brief every sprite drawn over any of the one handle points at, not counting itself
+int FindSpritesOverlapping(SpriteHandle handle, vector<SpriteHandle>& found){
+    found.clear();
+
+    int index = DenseIndex(handle);
+    if(index < 0) return 0;
+
+    uint32_t stamp = NewQueryStamp();
+    slotVisited[handle & 0xFFFF] = stamp;
+
+    const SpriteBoxes& boxes = denseBox[index];
+    for(int i = 0; i < boxes.count; i++){
+        ForEachOverlapping(boxes.box[i], stamp, [&](int other){ found.push_back(denseHandle[other]); });
+    }
+    return found.size();
+}
+
+SpatialIndexStats GetSpatialIndexStats(){
+    return spatialStats;
+}
+
+void ResetSpatialIndexStats(){
+    spatialStats = {};
+}
+
+/// @brief takes the sprite off and puts back everything else that was in its box, in draw order and clipped to the
+/// box, so nothing outside it gets touched
+static void RemoveSpriteFromGlobalLoop(SpriteHandle handle)
 {
-    if (!allSprites.count(name)){ 
+    int index = DenseIndex(handle);
+
+    if (index < 0){ 
          printf("erased\n"); 
          return;
         }
 
-    unordered_set<sprite_screen_structure*> overlaps = {&allSprites.at(name)};
+    //the backend rebuilds the box (or marks its tiles in retained mode), the others go back the way they were drawn
+    DrawToGlobal(denseSprite[index], 0);
+}
 
-    // //we know we've got the sprite somewhere in there
-    sprite_screen_structure* sprite = &allSprites[name];
+/// @brief takes a sprite off the screen, it stays in the registry. The wrap arguments don't matter anymore, it comes
+/// off the way it went on
+void RemoveSpriteFromGlobal(SpriteHandle handle, bool, Vector2, Vector2){
+    RemoveSpriteFromGlobalLoop(handle);
+}
 
-    FindAllOverlap(*sprite, overlaps); 
+void RemoveSpriteFromGlobal(const string& name, bool, Vector2, Vector2){
+    RemoveSpriteFromGlobalLoop(FindSpriteHandle(name));
+}
 
+void RefreshSprite(SpriteHandle handle){
+    RemoveSpriteFromGlobal(handle);
+    DrawToGlobalMove(handle);
+}
 
-    //now nuke every sprite thats overlapped at all
-    for(sprite_screen_structure* spr : overlaps){
-        DrawToGlobal(*spr, 0, wrapAround, wraparoundValueUnder, wraparoundValueOver);
-    }
+void RefreshSprite(const string& name){
+    RefreshSprite(FindSpriteHandle(name));
+}
 
-    for(sprite_screen_structure* spr : overlaps){ //do we need another loop or can it be in 1?
-        if(spr != sprite){
-            DrawToGlobal(*spr, 1, wrapAround, wraparoundValueUnder, wraparoundValueOver);
-        }
-    }
+
+void RemoveSpriteFromListAndGlobal(SpriteHandle handle){
+    RemoveSpriteFromGlobal(handle);
+    DropSprite(handle);
 }
 
- 
-void RemoveSpriteFromGlobal(string name, bool wrapAround, Vector2 wraparoundValueUnder, Vector2 wraparoundValueOver){
-    RemoveSpriteFromGlobalLoop(name, wrapAround, wraparoundValueUnder, wraparoundValueOver);
+void RemoveSpriteFromListAndGlobal(const string& name){
+    RemoveSpriteFromListAndGlobal(FindSpriteHandle(name));
 }
 
-void RefreshSprite(string name){
-    RemoveSpriteFromGlobal(name);
-    DrawToGlobalMove(name);
+/// @brief starts a scene. Everything made from here on gets removed by the EndScene with what this returns, and
+/// the arena goes back to where it was. Scenes can nest
+ScenePoint BeginScene(){
+    sceneMarks.resize(currentScene);
+    sceneMarks.push_back(SpriteArenaMark());
+
+    return {sceneMarks.back(), currentScene++};
 }
 
+/// @brief takes every sprite made since the matching BeginScene off the screen and out of the list, and hands
+/// their memory back. A scene that's already been ended (or thrown out by DeleteEverything) is left alone
+void EndScene(ScenePoint point){
+    if(point.scene >= sceneMarks.size() || sceneMarks[point.scene] != point.arenaTop) return;
+
+    vector<SpriteHandle> handles;
 
-void RemoveSpriteFromListAndGlobal(string name){
-    RemoveSpriteFromGlobal(name);
-    allSprites.erase(name);
+    for(size_t i = 0; i < denseSprite.size(); i++){
+        if(denseSprite[i].scene > point.scene) handles.push_back(denseHandle[i]);
+    }
+
+    for(SpriteHandle handle : handles) RemoveSpriteFromListAndGlobal(handle);
+
+    currentScene = point.scene;
+    sceneMarks.resize(min<size_t>(sceneMarks.size(), point.scene));
+    SpriteArenaReset(point.arenaTop);
 }
 
+SpriteArenaStats GetSpriteMemoryStats(){
+    return GetSpriteArenaStats();
+}
 
-/// @brief currently you can't specify size here, it just goes of longest string. Thats a fix for later
+
+/// @brief puts several lines of text in one sprite, gap pixels apart. Every line is padded out to the longest so an
+/// inverted one highlights the whole row. currently you can't specify size here, it just goes of longest string
 /// @param x
 /// @param y
 /// @param text
@@ -371,42 +1434,48 @@ void DisplayTextMultipleLines(int x, int y, const char **text, int size, int gap
         {x,
          y},
         {longest * 8,
-         8 * 7},
+         (float)min(64, (size - 1) * gap + 8)},
         {0}
     };
-    int counterForThingy = 0;
+
+    if(!AllocSpriteImage(textSprite)) return;
 
     for (int i = 0; i < size; i++)
     {   
-        WriteStringBlock(textSprite.img, 0, y, text[i], longest, &counterForThingy, (i == positionToInvert));
-        y = y + gap;
+        string line = text[i];
+        line.resize(longest, ' ');
+
+        DrawTextTo(textSprite.img, (int)textSprite.size.x, (int)textSprite.size.y, nullptr, 0, i * gap, line.c_str(), (i == positionToInvert));
     }
 
-    allSprites[name] = textSprite;
-    DrawToGlobal(textSprite, 1);
+    DrawToGlobal(StoreSprite(name, textSprite), 1);
 }
 
 
-/// @brief Taxes a C++ string, writes it to the screen as a sprite and saves it in the list like any other sprite
+/// @brief Taxes a C++ string, writes it to the screen as a sprite and saves it in the list like any other sprite.
+/// For text that doesn't need to move around on its own, DrawText(bufferGlobal, ...) skips the sprite altogether
 /// @param posX 
 /// @param posY 
 /// @param stringToConvert 
 /// @param nameOfSprite 
-void CreateNewTextSprite(int posX, int posY, string stringToConvert, string nameOfSprite, bool invert)
+SpriteHandle CreateNewTextSprite(int posX, int posY, string stringToConvert, string nameOfSprite, bool invert)
 {
     sprite_screen_structure text{
         {posX,
          posY},
-        {stringToConvert.length() * (size_t)8,
+        {(float)MeasureText(nullptr, stringToConvert.c_str()),
          8},
         {0}
     }; 
 
-    WriteString(text.img, posX, posY, stringToConvert.c_str(), invert);
+    if(!AllocSpriteImage(text)) return 0;
 
-    allSprites[nameOfSprite] = text;
-    
-    DrawToGlobal(text, 1);
+    DrawTextTo(text.img, (int)text.size.x, 8, nullptr, 0, 0, stringToConvert.c_str(), invert);
+
+    sprite_screen_structure& stored = StoreSprite(nameOfSprite, text);
+    DrawToGlobal(stored, 1);
+
+    return stored.handle;
 }
 
 /// @brief convert a center area to the side area
@@ -439,11 +1508,12 @@ int ConvertCenterToRightSideText(int position, string str){
 
 /// @brief Takes a text sprite and edits it with new text
 void ChangeTextSprite(string name, string text){
-    if(!allSprites.count(name)) return;
+    sprite_screen_structure* sprite = FindSprite(name);
+    if(!sprite) return;
 
 
-    Vector2 vec = {allSprites[name].pos.x, allSprites[name].pos.y};
-    RemoveSpriteFromGlobal(name);
+    Vector2 vec = sprite->pos;
+    RemoveSpriteFromGlobal(sprite->handle);
     CreateNewTextSprite(vec.x, vec.y, text, name);
 }
 
@@ -497,7 +1567,7 @@ Animation MoveListAddition(int posX, int posY, int destX, int destY, int timeToM
 
     //get a reference to the sprite that exists in the list and 
     ma.name = name;
-    ma.sprite = &allSprites[name];
+    ma.sprite = FindSpriteHandle(name);
     ma.timeToMove = timeToMove; //max movement time
     ma.destination = Vector2{destX, destY};
     ma.startingPosition = Vector2{posX, posY};
@@ -525,190 +1595,222 @@ AnimationManager SingleAnimation(int posX, int posY, int destX, int destY, int t
 
 
 
-/// @brief Flips a sprite by 180 degrees
-//I cant work out how to make this dynamic so right now it always goes by 90 degrees its using an if/else statement
-/// @param spr 
-void FlipSpriteOnX(sprite_screen_structure* spr, string str){
+// scratch for the quarter turns that can't be done in place, a static so it's not a 1 KB stack temporary. Anything
+// whose turned bitmap doesn't fit borrows a block from the arena for the turn instead
+static uint8_t transformScratch[1024];
 
-    RemoveSpriteFromGlobal(str);
+/// @brief flips, mirrors or turns a bitmap the sprite's size in place, quarter turns swap width and height. scratch
+/// has to hold the turned bitmap unless it's square
+static void TransformBitmap(uint8_t *img, uint8_t *scratch, int width, int height, int quarterTurns, bool mirrorX, bool mirrorY){
+    if(quarterTurns == 1 || quarterTurns == 3){
+        uint8_t *dst = (width == height) ? img : scratch;
 
-    sprite_screen_structure temp; 
+        if(quarterTurns == 1) RotateBitmap90(img, dst, width, height);
+        else RotateBitmap270(img, dst, width, height);
 
-    //get the bits of the sprite at 0 rotation and save it into a giant grid 
- 
-    //its easiest to assign everyhing to temp then copy it over
-    temp.size.x = spr->size.y; 
-    temp.size.y = spr->size.x;
-
-    temp.pos.x = spr->pos.x;
-    temp.pos.y = spr->pos.y;
+        if(dst != img) memcpy(img, dst, height * ((width + 7) / 8)); //the turned size
 
+        swap(width, height);
+    }else if(quarterTurns == 2){
+        RotateBitmap180(img, width, height);
+    }
 
-    int hexBitPosition = 0; //the bit position of the hex that we're 'moving'
-    int targetBitPosition = 0;//the bit position of the hex that we're editing
- 
+    if(mirrorX) MirrorBitmapX(img, width, height);
+    if(mirrorY) MirrorBitmapY(img, width, height);
+}
 
-    for(int y = 0; y < spr->size.y; y++){
+/// @brief flips, mirrors or turns a sprite's image and redraws it. The image keeps its own size so nothing past
+/// it gets copied. Quarter turns on square sprites happen in place. A mask gets the same done to it, in the sprite's
+/// own copy. If there's no room for the copy, or for the scratch a big sprite needs to turn, it stays as it is
+static void TransformSprite(sprite_screen_structure* spr, int quarterTurns, bool mirrorX, bool mirrorY){
 
-        if(hexBitPosition > 7){
-            hexBitPosition = 0;
-        }
-        targetBitPosition = 0;
+    int width = (int)spr->size.x, height = (int)spr->size.y;
+    quarterTurns &= 3;
 
+    int turnedBytes = height * ((width + 7) / 8);
+    uint8_t *scratch = transformScratch;
 
-        for(int x = 0; x < spr->size.x; x++){
-            //we need to count down the bits, right to left and put them top to bottom on the right f
+    if((quarterTurns & 1) && width != height && turnedBytes > (int)sizeof transformScratch){
+        scratch = SpriteArenaAlloc(turnedBytes);
+        if(!scratch) return;
+    }
 
-            if(targetBitPosition > 7){
-                targetBitPosition = 0;
-            }
+    // the mask in 'sprites' is shared, so it gets copied the first time before it's turned
+    if(spr->mask && !spr->ownMask){
+        spr->ownMask = AllocInScene(spr->imgBytes, spr->scene);
 
-            int currentHexPosition = ((int)(y / 8) * spr->size.x) + x;//the hex in the sprite we're rotating
-            int targetHexPosition = (temp.size.x - 1) + ((x / 8) * temp.size.x) - y; //the hex that we're editing
+        if(!spr->ownMask){
+            if(scratch != transformScratch) SpriteArenaFree(scratch, turnedBytes);
+            return;
+        }
 
-            bool bitValue = (spr->img[currentHexPosition] >> hexBitPosition) & 1; //and the bit in the SPRITES hex we are putting in
+        memcpy(spr->ownMask, spr->mask, width * ((height + 7) / 8));
+        spr->mask = spr->ownMask;
+    }
 
-            if(bitValue){
-                temp.img[targetHexPosition] |= 1  << targetBitPosition;
-            }
+    RemoveSpriteFromGlobal(spr->handle);
 
+    TransformBitmap(spr->img, scratch, width, height, quarterTurns, mirrorX, mirrorY);
+    if(spr->ownMask) TransformBitmap(spr->ownMask, scratch, width, height, quarterTurns, mirrorX, mirrorY);
 
-            targetBitPosition++;
-        }   
-       // sleep_ms(5000);
-        
-        hexBitPosition++;
+    if(scratch != transformScratch) SpriteArenaFree(scratch, turnedBytes);
 
+    if(quarterTurns == 1 || quarterTurns == 3){
+        spr->size.x = height;
+        spr->size.y = width;
     }
 
-     spr->size.x = temp.size.x;
-     spr->size.y = temp.size.y;
+    spr->sourceKey = 0;
 
-
-    for(int i = 0 ; i < 1023; i++){
-        spr->img[i] = 0x00;
-        spr->img[i] = temp.img[i];
-    }
- 
- 
     DrawToGlobal(*spr);
 
+    if(retainedMode) ComposeDirtyTiles();
     UpdateFromGlobal();
- }
+}
 
+/// @brief mirrors the sprite left to right. The name isn't needed anymore, the sprite knows its own handle
+void FlipSpriteOnX(sprite_screen_structure* spr, const string&){
+    TransformSprite(spr, 0, true, false);
+}
 
+/// @brief mirrors the sprite top to bottom. The name isn't needed anymore either
+void FlipSpriteOnY(sprite_screen_structure* spr, const string&){
+    TransformSprite(spr, 0, false, true);
+}
 
+/// @brief turns a sprite's image a quarter turn clockwise. rotation and the name aren't used, it's always 90
+void RotateSpriteClockwiseby90(sprite_screen_structure* spr, float, const string&){
+    TransformSprite(spr, 1, false, false);
+}
 
-/// @brief takes a sprite and returns a hex array thats a rotated version, always a 90 degree. 
-//I cant work out how to make this dynamic so right now it always goes by 90 degrees its using an if/else statement
-/// @param spr 
-void RotateSpriteClockwiseby90(sprite_screen_structure* spr, float rotation, string str){
+/// @brief turns a sprite's image by some number of quarter turns, negative goes anticlockwise. For angles that
+/// aren't a multiple of 90 use SetSpriteRotation
+void RotateSpriteQuarterTurns(sprite_screen_structure* spr, int turns){
+    TransformSprite(spr, turns, false, false);
+}
 
-    RemoveSpriteFromGlobal(str);
 
-    sprite_screen_structure temp; 
 
-    //get the bits of the sprite at 0 rotation and save it into a giant grid 
  
-    //its easiest to assign everyhing to temp then copy it over
-    temp.size.x = spr->size.y; 
-    temp.size.y = spr->size.x;
 
-    temp.pos.x = spr->pos.x;
-    temp.pos.y = spr->pos.y;
 
+/// @brief creates the sprite_structure_??? and adds it to the list, then calls RenderGoBetween
+SpriteHandle CreateNewSprite(int x, int y, const sprite_structure& spriteStructure, const string& name, BlendMode blend, int layer)
+{
+    if (FindSpriteHandle(name)) return 0; // already got one called that
 
-    int hexBitPosition = 0; //the bit position of the hex that we're 'moving'
-    int targetBitPosition = 0;//the bit position of the hex that we're editing
- 
+    sprite_screen_structure sprite = {{x, y}, {spriteStructure.size.x, spriteStructure.size.y}};
+    sprite.blend = blend;
+    sprite.layer = layer;
+    sprite.mask = spriteStructure.mask;
 
-    for(int y = 0; y < spr->size.y; y++){
+    if(!AllocSpriteImage(sprite)) return 0;
 
-        if(hexBitPosition > 7){
-            hexBitPosition = 0;
-        }
-        targetBitPosition = 0;
+    int size = spriteStructure.size.x * (((int)spriteStructure.size.y + 7) / 8); //a part page still takes a whole byte
+    size = min(size, (int)spriteStructure.img.size()); // anything left off the end stays blank
 
+    memcpy(sprite.img, spriteStructure.img.data(), size);
 
-        for(int x = 0; x < spr->size.x; x++){
-            //we need to count down the bits, right to left and put them top to bottom on the right f
+    SpriteHandle handle = AddSprite(name, sprite);
+    DrawToGlobal(*GetSprite(handle), 1);
 
-            if(targetBitPosition > 7){
-                targetBitPosition = 0;
-            }
-
-            int currentHexPosition = ((int)(y / 8) * spr->size.x) + x;//the hex in the sprite we're rotating
-            int targetHexPosition = (temp.size.x - 1) + ((x / 8) * temp.size.x) - y; //the hex that we're editing
+    return handle;
+}
 
-            bool bitValue = (spr->img[currentHexPosition] >> hexBitPosition) & 1; //and the bit in the SPRITES hex we are putting in
 
-            if(bitValue){
-                temp.img[targetHexPosition] |= 1  << targetBitPosition;
-            }
+int getRandomInRange(int min, int max)
+{ 
+#if !PICO_NO_HARDWARE
+    uint32_t r = get_rand_32();
+#else
+    uint32_t r = (uint32_t)rand(); // no pico_rand on the host build
+#endif
+    return min + (r % (max - min + 1));
+}
 
 
-            targetBitPosition++;
-        }   
-       // sleep_ms(5000);
-        
-        hexBitPosition++;
+/// @brief changes how a sprite gets combined with the screen, and redraws it that way
+void SetSpriteBlendMode(SpriteHandle handle, BlendMode blend){
+    sprite_screen_structure* sprite = GetSprite(handle);
+    if (!sprite) return;
 
-    }
+    RemoveSpriteFromGlobal(handle);
+    sprite->blend = blend;
+    DrawToGlobal(*sprite, 1, sprite->wrapAround, sprite->wrapMin, sprite->wrapMax);
+}
 
-     spr->size.x = temp.size.x;
-     spr->size.y = temp.size.y;
+void SetSpriteBlendMode(const string& name, BlendMode blend){
+    SetSpriteBlendMode(FindSpriteHandle(name), blend);
+}
 
+/// @brief turns a sprite to any angle (degrees clockwise) around its centre and redraws it. The angle gets snapped
+/// to the rotation steps, so if it hasn't moved a whole step nothing gets touched
+void SetSpriteRotation(SpriteHandle handle, float degrees){
+    sprite_screen_structure* sprite = GetSprite(handle);
+    if (!sprite) return;
 
-    for(int i = 0 ; i < 1023; i++){
-        spr->img[i] = 0x00;
-        spr->img[i] = temp.img[i];
+    if(SnapRotation(degrees) == sprite->drawnRotation){
+        sprite->rotation = degrees;
+        return;
     }
- 
- 
-    DrawToGlobal(*spr);
 
-    UpdateFromGlobal();
- }
+    RemoveSpriteFromGlobal(handle);
+    sprite->rotation = degrees;
+    DrawToGlobal(*sprite, 1, sprite->wrapAround, sprite->wrapMin, sprite->wrapMax);
+}
 
+void SetSpriteRotation(const string& name, float degrees){
+    SetSpriteRotation(FindSpriteHandle(name), degrees);
+}
 
 
- 
+/// @brief draws a sprite bigger or smaller, 2 is double size and 0.5 half. The top left stays where it is
+void SetSpriteScale(SpriteHandle handle, float scale){
+    sprite_screen_structure* sprite = GetSprite(handle);
+    if (!sprite || scale <= 0) return;
 
+    RemoveSpriteFromGlobal(handle);
+    sprite->scale = scale;
+    DrawToGlobal(*sprite, 1, sprite->wrapAround, sprite->wrapMin, sprite->wrapMax);
+}
 
-/// @brief creates the sprite_structure_??? and adds it to the list, then calls RenderGoBetween
-void CreateNewSprite(int x, int y, sprite_structure spriteStructure, string name)
-{
-    sprite_screen_structure sprite = {{x, y}, {spriteStructure.size.x, spriteStructure.size.y}};
+void SetSpriteScale(const string& name, float scale){
+    SetSpriteScale(FindSpriteHandle(name), scale);
+}
 
-    int size = spriteStructure.size.x * (spriteStructure.size.y > 8 ? spriteStructure.size.y / 8 : 1);
+/// @brief puts a sprite on a layer, higher layers always end up over lower ones. z orders it inside the layer,
+/// higher on top, and sprites with the same layer and z stack in the order they were made
+void SetSpriteLayer(SpriteHandle handle, int layer, int z){
+    int index = DenseIndex(handle);
+    if (index < 0) return;
 
-    
-    for (int i = 0; i < size; i++)
-    {
-        sprite.img[i] = spriteStructure.img[i]; // adding the array to the sprite structure
-    }
+    sprite_screen_structure* sprite = &denseSprite[index];
+    if (sprite->layer == layer && sprite->z == z) return;
 
-    allSprites.insert({name, sprite});
-    DrawToGlobal(sprite, 1);
-}
+    bool onScreen = denseBox[index].count > 0;
 
+    if(onScreen) RemoveSpriteFromGlobal(handle);
+    sprite->layer = layer;
+    sprite->z = z;
+    if(onScreen) DrawToGlobal(*sprite, 1, sprite->wrapAround, sprite->wrapMin, sprite->wrapMax);
+}
 
-int getRandomInRange(int min, int max)
-{ 
-    uint32_t r = get_rand_32();
-    return min + (r % (max - min + 1));
+void SetSpriteLayer(const string& name, int layer, int z){
+    SetSpriteLayer(FindSpriteHandle(name), layer, z);
 }
 
 
-/// @brief Go-between function that takes a string and calls DrawToGlobal
-void DrawToGlobalMove(string name, bool wrapAround, Vector2 wraparoundValueUnder, Vector2 wraparoundValueOver){
-    if (!allSprites.count(name)) return;
-    
-    //we know we've got the sprite somewhere in there
-    sprite_screen_structure* sprite = &allSprites[name];
+/// @brief Go-between function that takes a handle and calls DrawToGlobal
+void DrawToGlobalMove(SpriteHandle handle, bool wrapAround, Vector2 wraparoundValueUnder, Vector2 wraparoundValueOver){
+    sprite_screen_structure* sprite = GetSprite(handle);
+    if (!sprite) return;
 
     DrawToGlobalBackend(*sprite, 1, wrapAround, wraparoundValueUnder, wraparoundValueOver);
 }
+
+void DrawToGlobalMove(const string& name, bool wrapAround, Vector2 wraparoundValueUnder, Vector2 wraparoundValueOver){
+    DrawToGlobalMove(FindSpriteHandle(name), wrapAround, wraparoundValueUnder, wraparoundValueOver);
+}
   
 
 /// @brief returns whether we've make a full pixels movement or not
@@ -738,12 +1840,13 @@ Vector2 FullPixelMove(sprite_screen_structure &sp, Vector2 movement, int extraSt
 }
 
 
-Vector2 MoveSprite(string name, Vector2 movement, bool wrapAround, Vector2 wraparoundValueUnder, Vector2 wraparoundValueOver){
-    sprite_screen_structure *sp = &allSprites.at(name);
+Vector2 MoveSprite(SpriteHandle handle, Vector2 movement, bool wrapAround, Vector2 wraparoundValueUnder, Vector2 wraparoundValueOver){
+    sprite_screen_structure *sp = GetSprite(handle);
+    if(!sp) return {0, 0};
 
     Vector2 pixel = FullPixelMove(*sp, movement);
 
-    RemoveSpriteFromGlobal(name, wrapAround, wraparoundValueUnder, wraparoundValueOver);
+    RemoveSpriteFromGlobal(handle);
                   
 
 
@@ -751,33 +1854,39 @@ Vector2 MoveSprite(string name, Vector2 movement, bool wrapAround, Vector2 wrapa
     sp->pos.y += movement.y;
 
     if(wrapAround){
-        if(sp->pos.y >= wraparoundValueOver.y) sp->pos.y = wraparoundValueUnder.y;
-        else if(sp->pos.y <= wraparoundValueUnder.y) sp->pos.y = wraparoundValueOver.y;
-
-        if(sp->pos.x >= wraparoundValueOver.x) sp->pos.x = wraparoundValueUnder.x;
-        else if(sp->pos.x <= wraparoundValueUnder.x) sp->pos.x =  wraparoundValueOver.x;
+        sp->pos.x = WrapCoord(sp->pos.x, wraparoundValueUnder.x, wraparoundValueOver.x);
+        sp->pos.y = WrapCoord(sp->pos.y, wraparoundValueUnder.y, wraparoundValueOver.y);
     }
 
-    DrawToGlobalMove(name, true, wraparoundValueUnder, wraparoundValueOver);
+    DrawToGlobalMove(handle, wrapAround, wraparoundValueUnder, wraparoundValueOver);
     //CreateNewSprite(sp->pos.x, sp->pos.y, sp, "Snake");
 
     return pixel; //return the firection if either is used. We don't use this much.
 }
+
+Vector2 MoveSprite(const string& name, Vector2 movement, bool wrapAround, Vector2 wraparoundValueUnder, Vector2 wraparoundValueOver){
+    return MoveSprite(FindSpriteHandle(name), movement, wrapAround, wraparoundValueUnder, wraparoundValueOver);
+}
  
 
-void MoveToPosition(string name, Vector2 newPosition){
-    sprite_screen_structure *sp = &allSprites.at(name);
+void MoveToPosition(SpriteHandle handle, Vector2 newPosition){
+    sprite_screen_structure *sp = GetSprite(handle);
+    if(!sp) return;
  
-    RemoveSpriteFromGlobal(name);
+    RemoveSpriteFromGlobal(handle);
     //DeleteScreen();
     sp->pos.x = (int)newPosition.x;
     sp->pos.y = (int)newPosition.y;
 
-    DrawToGlobalMove(name);
+    DrawToGlobalMove(handle);
     //CreateNewSprite(sp->pos.x, sp->pos.y, sp, "Snake");
  
 }
 
+void MoveToPosition(const string& name, Vector2 newPosition){
+    MoveToPosition(FindSpriteHandle(name), newPosition);
+}
+
 
 
 
@@ -808,8 +1917,7 @@ Vector2 MoveSpriteCalculations(string name, float direction, float speed){
 
     ChangeDegree(direction, -90.0);
     
-    int time = to_ms_since_boot(get_absolute_time()) - lastTime;//the amount of time thats passed
-    float percent = (float)time / 1000; //percentage of a second thats passed
+    float percent = GetDeltaSeconds(); //percentage of a second thats passed, the same for every sprite this frame
 
     //convert the float to a vector2
 
@@ -831,8 +1939,7 @@ Vector2 MoveSpriteCalculations(string name, float direction, float speed){
 
 Vector2 MoveSpriteCalculations(string name, Vector2 direction, float speed){
 
-    int time = to_ms_since_boot(get_absolute_time()) - lastTime;//the amount of time thats passed
-    float percent = (float)time / 1000; //percentage of a second thats passed
+    float percent = GetDeltaSeconds(); //percentage of a second thats passed, the same for every sprite this frame
  
     Vector2 movement = {
         direction.x * speed * percent,
@@ -843,8 +1950,7 @@ Vector2 MoveSpriteCalculations(string name, Vector2 direction, float speed){
 
 Vector2 MoveSpriteCalculations(string name, Vector2 directionWithSpeed){
 
-    int time = to_ms_since_boot(get_absolute_time()) - lastTime;//the amount of time thats passed
-    float percent = (float)time / 1000; //percentage of a second thats passed
+    float percent = GetDeltaSeconds(); //percentage of a second thats passed, the same for every sprite this frame
 
     Vector2 movement = {
         directionWithSpeed.x * percent,
@@ -863,9 +1969,9 @@ void AnimationExecuter(){
     {
         Animation &ma = anims[i].animList[anims[i].animPosition]; //
         Vector2 pos = {};                                         // normalized position
-        int32_t current_time = to_ms_since_boot(get_absolute_time());
+        int32_t current_time = frameStartUs / 1000; // same clock for every animation this frame
 
-        MoveSprite(ma.name, MoveSpriteCalculations(ma.name, ma.speed));
+        MoveSprite(ma.sprite, MoveSpriteCalculations(ma.name, ma.speed));
 
 
 
@@ -899,7 +2005,92 @@ void AnimationExecuter(){
     }
 }
 
-void Update(){
+/// @brief how long the last frame took, worked out once in Update() so every sprite moved this frame sees the same value
+uint32_t GetDeltaUs(){
+    return frameDeltaUs;
+}
+
+float GetDeltaSeconds(){
+    return frameDeltaUs / 1000000.0f;
+}
+
+/// @brief Update() will sleep so frames come out at this rate. 0 turns pacing off
+void SetTargetFps(int fps){
+    framePeriodUs = fps > 0 ? 1000000 / fps : 0;
+    nextDeadlineUs = frameStartUs + framePeriodUs;
+}
+
+FrameStats GetFrameStats(){
+    FrameStats stats = frameStats;
+    stats.jitterUs = stats.frames > 1 ? sqrt(frameM2 / (stats.frames - 1)) : 0;
+    return stats;
+}
+
+void ResetFrameStats(){
+    frameStats = {};
+    frameMeanUs = 0;
+    frameM2 = 0;
+}
+
+/// @brief sleeps until the next frame is due (if pacing is on), then starts the new frame and works out its delta
+void FrameTick(){
+    uint64_t now = time_us_64();
+
+    if(framePeriodUs){
+        if(!frameStartUs){
+            //first frame, the schedule starts from here. SetTargetFps before it had nothing to go off
+            nextDeadlineUs = now;
+        }else if(now > nextDeadlineUs){
+            //too late, count it and start the schedule again from here rather than trying to catch up
+            frameStats.missedDeadlines++;
+            nextDeadlineUs = now;
+        }else{
+            sleep_until(from_us_since_boot(nextDeadlineUs));
+            now = time_us_64();
+        }
+        nextDeadlineUs += framePeriodUs;
+    }
+
+    frameDeltaUs = frameStartUs ? (uint32_t)(now - frameStartUs) : 0;
+    frameStartUs = now;
+
+    if(frameDeltaUs){
+        frameStats.frames++;
+        if(frameDeltaUs > frameStats.worstFrameUs) frameStats.worstFrameUs = frameDeltaUs;
+
+        double diff = frameDeltaUs - frameMeanUs;
+        frameMeanUs += diff / frameStats.frames;
+        frameM2 += diff * (frameDeltaUs - frameMeanUs);
+        frameStats.averageFrameUs = frameMeanUs;
+    }
+
     lastTime = to_ms_since_boot(get_absolute_time());
-    UpdateFromGlobal();
-}
\ No newline at end of file
+}
+
+/// @brief kicks off the flush and returns without waiting for it, the next Update() (or anything else that
+/// needs the bus) waits if it's still going. If StartDisplayCore() has been called the frame goes to core 1 instead.
+/// This is also the end of the frame, so this is where the frame pacing happens
+void Update(){
+    if(retainedMode) ComposeDirtyTiles();
+
+    if(DisplayCoreRunning()){
+        UpdateFromGlobalPipelined();
+    }else{
+        UpdateFromGlobalAsync(nullptr);
+    }
+
+    FrameTick();
+    PipelineFrameStart(); // the sleep is over, anything from here to the next Update is drawing
+}
+
+/// @brief Owns the main loop. Calls frame with the delta in seconds, runs the animations and updates the screen at
+/// targetFps until frame returns false
+void RunFrameLoop(int targetFps, const std::function<bool(float)>& frame){
+    SetTargetFps(targetFps);
+    FrameTick();
+
+    while(frame(GetDeltaSeconds())){
+        AnimationExecuter();
+        Update();
+    }
+}
@@ -17,23 +17,111 @@
 #include "pico/stdlib.h"
 #include "ssd1306_i2c.h"
 #include "pico/rand.h"
+#include "sprite_arena.h"
 
-extern map<string, sprite_screen_structure> allSprites;
+// what the blitter is allowed to touch, x1 and y1 are one past the edge
+struct ClipRect
+{
+    int x0, y0;
+    int x1, y1;
+};
+
+struct RotationCacheStats
+{
+    uint32_t hits = 0;
+    uint32_t misses = 0; // each one of these is a rotation that had to be worked out
+    uint32_t entries = 0;
+    uint32_t bytes = 0; // what the cached bitmaps are taking up
+};
+
+// what the spatial grid has been doing, candidates per query is what stays flat as the sprite count goes up
+struct SpatialIndexStats
+{
+    uint32_t queries = 0;
+    uint32_t cellsVisited = 0;
+    uint32_t candidates = 0; // sprites looked at, each one is a box compare
+    uint32_t updates = 0; // boxes that changed and got moved in the grid
+    uint32_t redrawn = 0; // sprites the rebuilds sorted and redrew, the only time a whole sprite record gets read
+};
+
+// where EndScene goes back to
+struct ScenePoint
+{
+    uint32_t arenaTop;
+    uint16_t scene;
+};
+
+struct FrameStats
+{
+    uint32_t frames = 0;
+    uint32_t missedDeadlines = 0; // frames that finished after they were due
+    uint32_t worstFrameUs = 0;
+    float averageFrameUs = 0;
+    float jitterUs = 0; // standard deviation of the frame time
+};
 
 
 
 void Update();
-void CreateNewTextSprite(int posX, int posY, std::string stringToConvert, std::string nameOfSprite, bool invert = false);
+void SetRetainedMode(bool on);
+bool GetRetainedMode();
+int ComposeDirtyTiles();
+void SetTargetFps(int fps);
+uint32_t GetDeltaUs();
+float GetDeltaSeconds();
+FrameStats GetFrameStats();
+void ResetFrameStats();
+void RunFrameLoop(int targetFps, const std::function<bool(float)>& frame);
+void AnimationExecuter();
+SpriteHandle CreateNewTextSprite(int posX, int posY, std::string stringToConvert, std::string nameOfSprite, bool invert = false);
 int ConvertCenterToSide(int position, int size);
 void DeleteEverything();
-void RemoveSpriteFromGlobal(string name, bool wrapAround = false, Vector2 wraparoundValueUnder = {0,0}, Vector2 wraparoundValueOver = {128,64});
-void CreateNewSprite(int x, int y, sprite_structure spriteStructure, string name);
-Vector2 MoveSprite(string name, Vector2 movement, bool wrapAround = true, Vector2 wraparoundValueUnder = { 1,1}, Vector2 wraparoundValueOver = {128,64});
+void RemoveSpriteFromGlobal(SpriteHandle handle, bool wrapAround = false, Vector2 wraparoundValueUnder = {0,0}, Vector2 wraparoundValueOver = {128,64});
+void RemoveSpriteFromGlobal(const string& name, bool wrapAround = false, Vector2 wraparoundValueUnder = {0,0}, Vector2 wraparoundValueOver = {128,64});
+SpriteHandle CreateNewSprite(int x, int y, const sprite_structure& spriteStructure, const string& name, BlendMode blend = BLEND_OR, int layer = 0);
+sprite_screen_structure* GetSprite(SpriteHandle handle);
+SpriteHandle FindSpriteHandle(const string& name);
+sprite_screen_structure* FindSprite(const string& name);
+int GetSpriteCount();
+int FindSpritesAt(int x, int y, vector<SpriteHandle>& found);
+int FindSpritesInRect(int x, int y, int width, int height, vector<SpriteHandle>& found);
+int FindSpritesOverlapping(SpriteHandle handle, vector<SpriteHandle>& found);
+SpatialIndexStats GetSpatialIndexStats();
+void ResetSpatialIndexStats();
+ScenePoint BeginScene();
+void EndScene(ScenePoint point);
+SpriteArenaStats GetSpriteMemoryStats();
+void SetSpriteBlendMode(SpriteHandle handle, BlendMode blend);
+void SetSpriteBlendMode(const string& name, BlendMode blend);
+void SetSpriteRotation(SpriteHandle handle, float degrees);
+void SetSpriteRotation(const string& name, float degrees);
+void SetSpriteScale(SpriteHandle handle, float scale);
+void SetSpriteScale(const string& name, float scale);
+void SetSpriteLayer(SpriteHandle handle, int layer, int z = 0);
+void SetSpriteLayer(const string& name, int layer, int z = 0);
+void FlipSpriteOnX(sprite_screen_structure* spr, const string& str);
+void FlipSpriteOnY(sprite_screen_structure* spr, const string& str);
+void RotateSpriteClockwiseby90(sprite_screen_structure* spr, float rotation, const string& str);
+void RotateSpriteQuarterTurns(sprite_screen_structure* spr, int turns);
+void SetRotationSteps(int stepsPerTurn);
+void SetRotationCacheSize(int entries);
+void ClearRotationCache();
+RotationCacheStats GetRotationCacheStats();
+Vector2 MoveSprite(SpriteHandle handle, Vector2 movement, bool wrapAround = true, Vector2 wraparoundValueUnder = {0,0}, Vector2 wraparoundValueOver = {128,64});
+Vector2 MoveSprite(const string& name, Vector2 movement, bool wrapAround = true, Vector2 wraparoundValueUnder = {0,0}, Vector2 wraparoundValueOver = {128,64});
+void MoveToPosition(SpriteHandle handle, Vector2 newPosition);
+void MoveToPosition(const string& name, Vector2 newPosition);
 Vector2 MoveSpriteCalculations(string name, Vector2 direction, float speed);
-void DrawToGlobalMove(string name, bool wrapAround = false, Vector2 wraparoundValueUnder = {1,1}, Vector2 wraparoundValueOver = {-128,64});
-void DrawToGlobal(sprite_screen_structure& sprite, int drawOrErase = 1, bool wrapAround = true, Vector2 wraparoundValueUnder = {-1,-1}, Vector2 wraparoundValueOver = {128,64});
-void RefreshSprite(string name);
-void RemoveSpriteFromListAndGlobal(string name);
+void DrawToGlobalMove(SpriteHandle handle, bool wrapAround = false, Vector2 wraparoundValueUnder = {0,0}, Vector2 wraparoundValueOver = {128,64});
+void DrawToGlobalMove(const string& name, bool wrapAround = false, Vector2 wraparoundValueUnder = {0,0}, Vector2 wraparoundValueOver = {128,64});
+void DrawToGlobal(sprite_screen_structure& sprite, int drawOrErase = 1, bool wrapAround = false, Vector2 wraparoundValueUnder = {0,0}, Vector2 wraparoundValueOver = {128,64});
+void PushClipRect(int x, int y, int width, int height);
+void PopClipRect();
+ClipRect GetClipRect();
+void RefreshSprite(SpriteHandle handle);
+void RefreshSprite(const string& name);
+void RemoveSpriteFromListAndGlobal(SpriteHandle handle);
+void RemoveSpriteFromListAndGlobal(const string& name);
 void RemoveArea(int xPixelStart, int xPixelEnd, int yPixelStart, int yPixelEnd);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include <string.h>
+#include "sprite_arena.h"
+
+#define SPRITE_ARENA_MIN_CLASS 8
+#define SPRITE_ARENA_CLASSES 12 // 8 bytes up to 16 KB
+
+alignas(8) static uint8_t arena[SPRITE_ARENA_BYTES];
+static uint32_t arenaTop = 0;
+static uint8_t *freeLists[SPRITE_ARENA_CLASSES] = {};
+static SpriteArenaStats arenaStats = {};
+
+static inline int SizeClass(int bytes){
+    int sizeClass = 0;
+    while((SPRITE_ARENA_MIN_CLASS << sizeClass) < bytes) sizeClass++;
+    return sizeClass;
+}
+
+// the next pointer of a freed block is kept in the block itself
+static inline uint8_t *NextFree(uint8_t *block){
+    uint8_t *next;
+    memcpy(&next, block, sizeof(next));
+    return next;
+}
+
+static inline void SetNextFree(uint8_t *block, uint8_t *next){
+    memcpy(block, &next, sizeof(next));
+}
+
+/// @brief a zeroed block of at least bytes that ends at or under mark, off the free list if there's one that size,
+/// otherwise off the top
+static uint8_t *AllocUnder(int bytes, uint32_t mark){
+    int sizeClass = SizeClass(bytes);
+
+    if(bytes <= 0 || sizeClass >= SPRITE_ARENA_CLASSES){
+        arenaStats.failures++;
+        return nullptr;
+    }
+
+    uint32_t classBytes = SPRITE_ARENA_MIN_CLASS << sizeClass;
+    uint8_t *block = nullptr;
+
+    // first one on the list that's low enough
+    for(uint8_t *prev = nullptr, *free = freeLists[sizeClass]; free; prev = free, free = NextFree(free)){
+        if(free + classBytes > &arena[mark]) continue;
+
+        if(prev) SetNextFree(prev, NextFree(free));
+        else freeLists[sizeClass] = NextFree(free);
+
+        block = free;
+        break;
+    }
+
+    if(!block){
+        if(arenaTop + classBytes > mark){
+            arenaStats.failures++;
+            return nullptr;
+        }
+
+        block = &arena[arenaTop];
+        arenaTop += classBytes;
+    }
+
+    memset(block, 0, classBytes);
+
+    arenaStats.allocations++;
+    arenaStats.liveBytes += classBytes;
+    if(arenaStats.liveBytes > arenaStats.peakBytes) arenaStats.peakBytes = arenaStats.liveBytes;
+
+    return block;
+}
+
+/// @brief a zeroed block of at least bytes, off the free list if there's one that size, otherwise off the top
+/// @return nullptr if it doesn't fit
+uint8_t *SpriteArenaAlloc(int bytes){
+    return AllocUnder(bytes, SPRITE_ARENA_BYTES);
+}
+
+/// @brief same as SpriteArenaAlloc but the block has to sit under mark, so resetting back to mark doesn't take it
+uint8_t *SpriteArenaAllocBelow(int bytes, uint32_t mark){
+    return AllocUnder(bytes, mark < SPRITE_ARENA_BYTES ? mark : SPRITE_ARENA_BYTES);
+}
+
+/// @brief true if the whole block is under mark
+bool SpriteArenaBelow(const uint8_t *block, int bytes, uint32_t mark){
+    return block + SpriteArenaBlockBytes(bytes) <= &arena[0] + mark;
+}
+
+/// @brief how big the block for bytes really is, anything that rounds up to the same size can reuse it
+int SpriteArenaBlockBytes(int bytes){
+    return SPRITE_ARENA_MIN_CLASS << SizeClass(bytes);
+}
+
+/// @brief hands a block back, bytes has to be what it was allocated with
+void SpriteArenaFree(uint8_t *block, int bytes){
+    if(!block) return;
+
+    int sizeClass = SizeClass(bytes);
+
+    SetNextFree(block, freeLists[sizeClass]);
+    freeLists[sizeClass] = block;
+
+    arenaStats.liveBytes -= SPRITE_ARENA_MIN_CLASS << sizeClass;
+}
+
+/// @brief where the top is now, to reset back to later
+uint32_t SpriteArenaMark(){
+    return arenaTop;
+}
+
+/// @brief throws away everything above mark, anything up there should already have been freed. Blocks under the
+/// mark that are on a free list stay there
+void SpriteArenaReset(uint32_t mark){
+    if(mark >= arenaTop) return;
+
+    arenaTop = mark;
+
+    for(int c = 0; c < SPRITE_ARENA_CLASSES; c++){
+        uint8_t *keep = nullptr;
+
+        for(uint8_t *block = freeLists[c]; block;){
+            uint8_t *next = NextFree(block);
+
+            if(block < &arena[mark]){
+                SetNextFree(block, keep);
+                keep = block;
+            }
+
+            block = next;
+        }
+
+        freeLists[c] = keep;
+    }
+
+    arenaStats.topBytes = arenaTop;
+}
+
+SpriteArenaStats GetSpriteArenaStats(){
+    arenaStats.topBytes = arenaTop;
+    return arenaStats;
+}
+
+void ResetSpriteArenaPeak(){
+    arenaStats.peakBytes = arenaStats.liveBytes;
+}
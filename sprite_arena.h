@@ -0,0 +1,37 @@
+#ifndef SPRITEARENAH
+#define SPRITEARENAH
+
+#include <stdint.h>
+
+/*
+ Where sprite bitmaps live. One static block that bitmaps get bumped off the top of, rounded up to a power of two
+ size class (8 bytes up). Freeing a bitmap puts it on that class's free list so the next one the same size reuses
+ it, which is what happens all game with pellets and snake segments. A mark is just how far up the block is used,
+ resetting to one throws away everything allocated after it in one go, which is how scenes get cleaned up
+*/
+
+#ifndef SPRITE_ARENA_BYTES
+#define SPRITE_ARENA_BYTES (16 * 1024)
+#endif
+
+struct SpriteArenaStats
+{
+    uint32_t liveBytes = 0; // in bitmaps right now, size classes included
+    uint32_t peakBytes = 0; // most liveBytes has ever been
+    uint32_t topBytes = 0; // how far up the block is bumped, freed blocks sitting on a free list included
+    uint32_t capacityBytes = SPRITE_ARENA_BYTES;
+    uint32_t allocations = 0;
+    uint32_t failures = 0; // allocations that didn't fit
+};
+
+uint8_t *SpriteArenaAlloc(int bytes);
+uint8_t *SpriteArenaAllocBelow(int bytes, uint32_t mark);
+bool SpriteArenaBelow(const uint8_t *block, int bytes, uint32_t mark);
+int SpriteArenaBlockBytes(int bytes);
+void SpriteArenaFree(uint8_t *block, int bytes);
+uint32_t SpriteArenaMark();
+void SpriteArenaReset(uint32_t mark);
+SpriteArenaStats GetSpriteArenaStats();
+void ResetSpriteArenaPeak();
+
+#endif
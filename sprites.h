@@ -46,22 +46,61 @@ const vector<string> tags = {
 
 };
 
+/// How a sprite's bits get combined with what's already on the screen
+/// OR: set bits turn pixels on, clear bits leave them alone (the old behaviour)
+/// AND: clear bits turn pixels off, set bits leave them alone
+/// XOR: set bits flip pixels, so drawing it twice puts the screen back the way it was
+/// MASKED: opaque, everything under the mask gets replaced with the sprite. No mask means the whole box
+enum BlendMode
+{
+    BLEND_OR,
+    BLEND_AND,
+    BLEND_XOR,
+    BLEND_MASKED
+};
+
 struct sprite_structure
 {
     Vector2 size;
-    uint8_t img[1024]; // max size is 1024 but just in case
+    vector<uint8_t> img; // width * ceil(height / 8) bytes, page format
+    const uint8_t *mask = nullptr; // optional, same layout as img, set bits are the opaque part for BLEND_MASKED
 };
 
+// a sprite in the registry, the slot in the low 16 bits and the slot's generation in the top 16. 0 is never a sprite
+typedef uint32_t SpriteHandle;
+
 struct sprite_screen_structure
 {
     Vector2 pos;
     Vector2 size;
-    float rotation;
+    float rotation = 0; // degrees clockwise, img stays unrotated and the rotated one comes out of the rotation cache
+    float scale = 1; // drawn this many times bigger (or smaller), top left stays at pos
+
+    BlendMode blend = BLEND_OR;
+    const uint8_t *mask = nullptr; //points at the mask in 'sprites', or at ownMask once the image has been flipped or turned
+    uint8_t *ownMask = nullptr; // the sprite's own copy of the mask in the arena, imgBytes like img
+
+    // how it was last drawn, so erasing it takes off exactly what went on
+    bool wrapAround = false;
+    Vector2 wrapMin = {0, 0};
+    Vector2 wrapMax = {128, 64};
+    float drawnRotation = 0; // already snapped to the rotation steps
+    int32_t drawnScale = 1 << 16; // 16.16 fixed point
+
+    uint32_t sourceKey = 0; // hash of img for the rotation cache, set it back to 0 if you change img
 
     pair<const string, sprite_structure>* sprite; //this is safe as 'sprites' is const and never getting altered in-game
     
-    //current hex saved, including rotation. This is inneficient on memory but more efficient on not having to recalculate rotation a lot
-    uint8_t img[1024] = {0x00}; 
+    //current hex saved, including quarter turns and flips. It comes out of the sprite arena at its real size, with
+    //room to be turned sideways in place, and goes back when the sprite is removed
+    uint8_t *img = nullptr;
+    uint16_t imgBytes = 0; // what was allocated, to give it back
+    uint16_t scene = 0; // the scene it was made in, see BeginScene
+    SpriteHandle handle = 0; // 0 if it isn't in the registry
+
+    int layer = 0; // higher layers go on top
+    int z = 0; // order inside the layer, higher on top
+    uint32_t sequence = 0; // when it was made, so sprites on the same layer and z always stack the same way
 };
 
 const unordered_map<string, sprite_structure> sprites = {
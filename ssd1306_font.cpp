@@ -0,0 +1,276 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "ssd1306_font.h"
+
+/*
+ The font tables. Everything in here is constexpr, so the compiler builds the full tables (the 8x8 filled out to
+ all of ASCII, the doubled 16 pixel one, the proportional metrics) and they end up as const data in flash, nothing
+ gets worked out or copied into RAM at startup. Every font starts at space and goes in ASCII order, so a glyph is
+ (ch - ' ') * bytes per glyph, one indexed load.
+*/
+
+#define FONT_FIRST ' '
+#define FONT_COUNT 96 // space to DEL
+
+// classic 5x7, columns left to right, bit 0 at the top
+static constexpr uint8_t font5x7[FONT_COUNT * 5] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, // space
+    0x00, 0x00, 0x5F, 0x00, 0x00, // !
+    0x00, 0x07, 0x00, 0x07, 0x00, // "
+    0x14, 0x7F, 0x14, 0x7F, 0x14, // #
+    0x24, 0x2A, 0x7F, 0x2A, 0x12, // $
+    0x23, 0x13, 0x08, 0x64, 0x62, // %
+    0x36, 0x49, 0x55, 0x22, 0x50, // &
+    0x00, 0x05, 0x03, 0x00, 0x00, // '
+    0x00, 0x1C, 0x22, 0x41, 0x00, // (
+    0x00, 0x41, 0x22, 0x1C, 0x00, // )
+    0x14, 0x08, 0x3E, 0x08, 0x14, // *
+    0x08, 0x08, 0x3E, 0x08, 0x08, // +
+    0x00, 0x50, 0x30, 0x00, 0x00, // ,
+    0x08, 0x08, 0x08, 0x08, 0x08, // -
+    0x00, 0x60, 0x60, 0x00, 0x00, // .
+    0x20, 0x10, 0x08, 0x04, 0x02, // /
+    0x3E, 0x51, 0x49, 0x45, 0x3E, // 0
+    0x00, 0x42, 0x7F, 0x40, 0x00, // 1
+    0x42, 0x61, 0x51, 0x49, 0x46, // 2
+    0x21, 0x41, 0x45, 0x4B, 0x31, // 3
+    0x18, 0x14, 0x12, 0x7F, 0x10, // 4
+    0x27, 0x45, 0x45, 0x45, 0x39, // 5
+    0x3C, 0x4A, 0x49, 0x49, 0x30, // 6
+    0x01, 0x71, 0x09, 0x05, 0x03, // 7
+    0x36, 0x49, 0x49, 0x49, 0x36, // 8
+    0x06, 0x49, 0x49, 0x29, 0x1E, // 9
+    0x00, 0x36, 0x36, 0x00, 0x00, // :
+    0x00, 0x56, 0x36, 0x00, 0x00, // ;
+    0x08, 0x14, 0x22, 0x41, 0x00, // <
+    0x14, 0x14, 0x14, 0x14, 0x14, // =
+    0x00, 0x41, 0x22, 0x14, 0x08, // >
+    0x02, 0x01, 0x51, 0x09, 0x06, // ?
+    0x32, 0x49, 0x79, 0x41, 0x3E, // @
+    0x7E, 0x11, 0x11, 0x11, 0x7E, // A
+    0x7F, 0x49, 0x49, 0x49, 0x36, // B
+    0x3E, 0x41, 0x41, 0x41, 0x22, // C
+    0x7F, 0x41, 0x41, 0x22, 0x1C, // D
+    0x7F, 0x49, 0x49, 0x49, 0x41, // E
+    0x7F, 0x09, 0x09, 0x01, 0x01, // F
+    0x3E, 0x41, 0x41, 0x51, 0x32, // G
+    0x7F, 0x08, 0x08, 0x08, 0x7F, // H
+    0x00, 0x41, 0x7F, 0x41, 0x00, // I
+    0x20, 0x40, 0x41, 0x3F, 0x01, // J
+    0x7F, 0x08, 0x14, 0x22, 0x41, // K
+    0x7F, 0x40, 0x40, 0x40, 0x40, // L
+    0x7F, 0x02, 0x04, 0x02, 0x7F, // M
+    0x7F, 0x04, 0x08, 0x10, 0x7F, // N
+    0x3E, 0x41, 0x41, 0x41, 0x3E, // O
+    0x7F, 0x09, 0x09, 0x09, 0x06, // P
+    0x3E, 0x41, 0x51, 0x21, 0x5E, // Q
+    0x7F, 0x09, 0x19, 0x29, 0x46, // R
+    0x46, 0x49, 0x49, 0x49, 0x31, // S
+    0x01, 0x01, 0x7F, 0x01, 0x01, // T
+    0x3F, 0x40, 0x40, 0x40, 0x3F, // U
+    0x1F, 0x20, 0x40, 0x20, 0x1F, // V
+    0x7F, 0x20, 0x18, 0x20, 0x7F, // W
+    0x63, 0x14, 0x08, 0x14, 0x63, // X
+    0x03, 0x04, 0x78, 0x04, 0x03, // Y
+    0x61, 0x51, 0x49, 0x45, 0x43, // Z
+    0x00, 0x7F, 0x41, 0x41, 0x00, // [
+    0x02, 0x04, 0x08, 0x10, 0x20, // backslash
+    0x00, 0x41, 0x41, 0x7F, 0x00, // ]
+    0x04, 0x02, 0x01, 0x02, 0x04, // ^
+    0x40, 0x40, 0x40, 0x40, 0x40, // _
+    0x00, 0x01, 0x02, 0x04, 0x00, // `
+    0x20, 0x54, 0x54, 0x54, 0x78, // a
+    0x7F, 0x48, 0x44, 0x44, 0x38, // b
+    0x38, 0x44, 0x44, 0x44, 0x20, // c
+    0x38, 0x44, 0x44, 0x48, 0x7F, // d
+    0x38, 0x54, 0x54, 0x54, 0x18, // e
+    0x08, 0x7E, 0x09, 0x01, 0x02, // f
+    0x0C, 0x52, 0x52, 0x52, 0x3E, // g
+    0x7F, 0x08, 0x04, 0x04, 0x78, // h
+    0x00, 0x44, 0x7D, 0x40, 0x00, // i
+    0x20, 0x40, 0x44, 0x3D, 0x00, // j
+    0x7F, 0x10, 0x28, 0x44, 0x00, // k
+    0x00, 0x41, 0x7F, 0x40, 0x00, // l
+    0x7C, 0x04, 0x18, 0x04, 0x78, // m
+    0x7C, 0x08, 0x04, 0x04, 0x78, // n
+    0x38, 0x44, 0x44, 0x44, 0x38, // o
+    0x7C, 0x14, 0x14, 0x14, 0x08, // p
+    0x08, 0x14, 0x14, 0x18, 0x7C, // q
+    0x7C, 0x08, 0x04, 0x04, 0x08, // r
+    0x48, 0x54, 0x54, 0x54, 0x20, // s
+    0x04, 0x3F, 0x44, 0x40, 0x20, // t
+    0x3C, 0x40, 0x40, 0x20, 0x7C, // u
+    0x1C, 0x20, 0x40, 0x20, 0x1C, // v
+    0x3C, 0x40, 0x30, 0x40, 0x3C, // w
+    0x44, 0x28, 0x10, 0x28, 0x44, // x
+    0x0C, 0x50, 0x50, 0x50, 0x3C, // y
+    0x44, 0x64, 0x54, 0x4C, 0x44, // z
+    0x00, 0x08, 0x36, 0x41, 0x00, // {
+    0x00, 0x00, 0x7F, 0x00, 0x00, // |
+    0x00, 0x41, 0x36, 0x08, 0x00, // }
+    0x10, 0x08, 0x08, 0x10, 0x08, // ~
+    0x00, 0x00, 0x00, 0x00, 0x00, // DEL, blank
+};
+
+// the original 8x8 glyphs: blank, A-Z, 0-9, - / ! ?
+static constexpr uint8_t legacy8x8[41 * 8] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // Nothing
+    0x78, 0x14, 0x12, 0x11, 0x12, 0x14, 0x78, 0x00, // A
+    0x7F, 0x09, 0x49, 0x49, 0x49, 0x49, 0x7F, 0x00, // B
+    0x7E, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x00, // C
+    0x7F, 0x41, 0x41, 0x41, 0x41, 0x41, 0x7E, 0x00, // D
+    0x7F, 0x49, 0x49, 0x49, 0x49, 0x49, 0x49, 0x00, // E
+    0x7F, 0x09, 0x09, 0x09, 0x09, 0x01, 0x01, 0x00, // F
+    0x7F, 0x41, 0x41, 0x41, 0x51, 0x51, 0x73, 0x00, // G
+    0x7F, 0x08, 0x08, 0x08, 0x08, 0x08, 0x7F, 0x00, // H
+    0x00, 0x00, 0x00, 0x7F, 0x00, 0x00, 0x00, 0x00, // I
+    0x21, 0x41, 0x41, 0x3F, 0x01, 0x01, 0x01, 0x00, // J
+    0x00, 0x7F, 0x08, 0x08, 0x14, 0x22, 0x41, 0x00, // K
+    0x7F, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00, // L
+    0x7F, 0x02, 0x04, 0x08, 0x04, 0x02, 0x7F, 0x00, // M
+    0x7F, 0x02, 0x04, 0x08, 0x10, 0x20, 0x7F, 0x00, // N
+    0x3E, 0x41, 0x41, 0x41, 0x41, 0x41, 0x3E, 0x00, // O
+    0x7F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00, // P
+    0x3E, 0x41, 0x41, 0x49, 0x51, 0x61, 0x7E, 0x00, // Q
+    0x7F, 0x11, 0x11, 0x11, 0x31, 0x51, 0x0E, 0x00, // R
+    0x46, 0x49, 0x49, 0x49, 0x49, 0x30, 0x00, 0x00, // S
+    0x01, 0x01, 0x01, 0x7F, 0x01, 0x01, 0x01, 0x00, // T
+    0x3F, 0x40, 0x40, 0x40, 0x40, 0x40, 0x3F, 0x00, // U
+    0x0F, 0x10, 0x20, 0x40, 0x20, 0x10, 0x0F, 0x00, // V
+    0x7F, 0x20, 0x10, 0x08, 0x10, 0x20, 0x7F, 0x00, // W
+    0x00, 0x41, 0x22, 0x14, 0x14, 0x22, 0x41, 0x00, // X
+    0x01, 0x02, 0x04, 0x78, 0x04, 0x02, 0x01, 0x00, // Y
+    0x41, 0x61, 0x59, 0x45, 0x43, 0x41, 0x00, 0x00, // Z
+    0x3E, 0x41, 0x41, 0x49, 0x41, 0x41, 0x3E, 0x00, // 0
+    0x00, 0x00, 0x42, 0x7F, 0x40, 0x00, 0x00, 0x00, // 1
+    0x30, 0x49, 0x49, 0x49, 0x49, 0x46, 0x00, 0x00, // 2
+    0x49, 0x49, 0x49, 0x49, 0x49, 0x49, 0x36, 0x00, // 3
+    0x3F, 0x20, 0x20, 0x78, 0x20, 0x20, 0x00, 0x00, // 4
+    0x4F, 0x49, 0x49, 0x49, 0x49, 0x30, 0x00, 0x00, // 5
+    0x3F, 0x48, 0x48, 0x48, 0x48, 0x48, 0x30, 0x00, // 6
+    0x01, 0x01, 0x01, 0x61, 0x31, 0x0D, 0x03, 0x00, // 7
+    0x36, 0x49, 0x49, 0x49, 0x49, 0x49, 0x36, 0x00, // 8
+    0x06, 0x09, 0x09, 0x09, 0x09, 0x09, 0x7F, 0x00, // 9
+    0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, // just a line
+    0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x00, // slash
+    0x00, 0x00, 0x39, 0x39, 0x00, 0x00, 0x00, 0x00, // exclamation mark
+    0x00, 0x00, 0x38, 0x0D, 0x18, 0x00, 0x00, 0x00, // question mark
+};
+
+// which original glyph each character used to get, 0 if it never had one
+static constexpr int LegacyGlyph(int ch) {
+    if (ch >= 'A' && ch <= 'Z') return ch - 'A' + 1;
+    if (ch >= '0' && ch <= '9') return ch - '0' + 27;
+    if (ch == '-') return 37;
+    if (ch == '/') return 38;
+    if (ch == '!') return 39;
+    if (ch == '?') return 40;
+    return 0;
+}
+
+template <size_t N>
+struct GlyphTable {
+    uint8_t data[N];
+};
+
+template <int Count>
+struct Metrics {
+    uint8_t left[Count];
+    uint8_t advance[Count];
+};
+
+// the original glyphs where there is one, everything else is the 5x7 moved one column in
+static constexpr GlyphTable<FONT_COUNT * 8> Build8x8() {
+    GlyphTable<FONT_COUNT * 8> table = {};
+
+    for (int i = 0; i < FONT_COUNT; i++) {
+        int legacy = LegacyGlyph(FONT_FIRST + i);
+
+        for (int c = 0; c < 8; c++) {
+            if (legacy) table.data[i * 8 + c] = legacy8x8[legacy * 8 + c];
+            else if (c >= 1 && c <= 5) table.data[i * 8 + c] = font5x7[i * 5 + c - 1];
+        }
+    }
+
+    return table;
+}
+
+// 5x7 padded to a 6 wide cell so fixed width text has a gap
+static constexpr GlyphTable<FONT_COUNT * 6> Build5x7() {
+    GlyphTable<FONT_COUNT * 6> table = {};
+
+    for (int i = 0; i < FONT_COUNT; i++) {
+        for (int c = 0; c < 5; c++) table.data[i * 6 + c] = font5x7[i * 5 + c];
+    }
+
+    return table;
+}
+
+// every pixel of the 8x8 becomes 2x2, so each column turns into two 16 row columns over two pages
+static constexpr GlyphTable<FONT_COUNT * 32> Build16(const GlyphTable<FONT_COUNT * 8>& small) {
+    GlyphTable<FONT_COUNT * 32> table = {};
+
+    for (int i = 0; i < FONT_COUNT; i++) {
+        for (int c = 0; c < 8; c++) {
+            uint8_t column = small.data[i * 8 + c];
+            uint16_t doubled = 0;
+
+            for (int bit = 0; bit < 8; bit++) {
+                if ((column >> bit) & 1) doubled |= 3u << (bit * 2);
+            }
+
+            for (int half = 0; half < 2; half++) {
+                table.data[i * 32 + c * 2 + half] = (uint8_t)doubled;
+                table.data[i * 32 + 16 + c * 2 + half] = (uint8_t)(doubled >> 8);
+            }
+        }
+    }
+
+    return table;
+}
+
+// where each glyph's ink starts and how wide it is, blanks get `blank` columns
+template <size_t N>
+static constexpr Metrics<FONT_COUNT> Measure(const GlyphTable<N>& glyphs, int width, int pages, int blank) {
+    Metrics<FONT_COUNT> metrics = {};
+
+    for (int i = 0; i < FONT_COUNT; i++) {
+        int first = -1, last = -1;
+
+        for (int c = 0; c < width; c++) {
+            bool ink = false;
+            for (int p = 0; p < pages; p++) ink = ink || glyphs.data[i * width * pages + p * width + c];
+
+            if (ink) {
+                if (first < 0) first = c;
+                last = c;
+            }
+        }
+
+        metrics.left[i] = first < 0 ? 0 : first;
+        metrics.advance[i] = first < 0 ? blank : last - first + 1;
+    }
+
+    return metrics;
+}
+
+static constexpr GlyphTable<FONT_COUNT * 8> glyphs8x8 = Build8x8();
+static constexpr GlyphTable<FONT_COUNT * 6> glyphs5x7 = Build5x7();
+static constexpr GlyphTable<FONT_COUNT * 32> glyphs16 = Build16(glyphs8x8);
+
+static constexpr Metrics<FONT_COUNT> metrics8x8 = Measure(glyphs8x8, 8, 1, 3);
+static constexpr Metrics<FONT_COUNT> metrics5x7 = Measure(glyphs5x7, 6, 1, 2);
+static constexpr Metrics<FONT_COUNT> metrics16 = Measure(glyphs16, 16, 2, 6);
+
+extern "C" {
+
+const struct ssd1306_font ssd1306_font_8x8 = { glyphs8x8.data, NULL, NULL, NULL, 8, 8, FONT_FIRST, FONT_COUNT, 0 };
+const struct ssd1306_font ssd1306_font_8x8_proportional = { glyphs8x8.data, NULL, metrics8x8.left, metrics8x8.advance, 8, 8, FONT_FIRST, FONT_COUNT, 1 };
+
+const struct ssd1306_font ssd1306_font_5x7 = { glyphs5x7.data, NULL, NULL, NULL, 6, 7, FONT_FIRST, FONT_COUNT, 0 };
+const struct ssd1306_font ssd1306_font_5x7_proportional = { glyphs5x7.data, NULL, metrics5x7.left, metrics5x7.advance, 6, 7, FONT_FIRST, FONT_COUNT, 1 };
+
+const struct ssd1306_font ssd1306_font_16 = { glyphs16.data, NULL, NULL, NULL, 16, 16, FONT_FIRST, FONT_COUNT, 0 };
+const struct ssd1306_font ssd1306_font_16_proportional = { glyphs16.data, NULL, metrics16.left, metrics16.advance, 16, 16, FONT_FIRST, FONT_COUNT, 2 };
+
+}
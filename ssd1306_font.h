@@ -4,50 +4,39 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
-// Vertical bitmaps, A-Z, 0-9. Each is 8 pixels high and wide
-// These are defined vertically to make them quick to copy to FB
+#ifndef SSD1306FONTH
+#define SSD1306FONTH
 
-static uint8_t font[] = {
-0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // Nothing
-0x78, 0x14, 0x12, 0x11, 0x12, 0x14, 0x78, 0x00, //A
-0x7f, 0x09, 0x49, 0x49, 0x49, 0x49, 0x7f, 0x00, //B
-0x7e, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x00, //C
-0x7f, 0x41, 0x41, 0x41, 0x41, 0x41, 0x7e, 0x00, //D 
-0x7f, 0x49, 0x49, 0x49, 0x49, 0x49, 0x49, 0x00, //E
-0x7f, 0x09, 0x09, 0x09, 0x09, 0x01, 0x01, 0x00, //F
-0x7f, 0x41, 0x41, 0x41, 0x51, 0x51, 0x73, 0x00, //G
-0x7f, 0x08, 0x08, 0x08, 0x08, 0x08, 0x7f, 0x00, //H
-0x00, 0x00, 0x00, 0x7f, 0x00, 0x00, 0x00, 0x00, //I
-0x21, 0x41, 0x41, 0x3f, 0x01, 0x01, 0x01, 0x00, //J
-0x00, 0x7f, 0x08, 0x08, 0x14, 0x22, 0x41, 0x00, //K
-0x7f, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00, //L
-0x7f, 0x02, 0x04, 0x08, 0x04, 0x02, 0x7f, 0x00, //M
-0x7f, 0x02, 0x04, 0x08, 0x10, 0x20, 0x7f, 0x00, //N
-0x3e, 0x41, 0x41, 0x41, 0x41, 0x41, 0x3e, 0x00, //O
-0x7f, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e, 0x00, //P
-0x3e, 0x41, 0x41, 0x49, 0x51, 0x61, 0x7e, 0x00, //Q
-0x7f, 0x11, 0x11, 0x11, 0x31, 0x51, 0x0e, 0x00, //R
-0x46, 0x49, 0x49, 0x49, 0x49, 0x30, 0x00, 0x00, //S
-0x01, 0x01, 0x01, 0x7f, 0x01, 0x01, 0x01, 0x00, //T
-0x3f, 0x40, 0x40, 0x40, 0x40, 0x40, 0x3f, 0x00, //U
-0x0f, 0x10, 0x20, 0x40, 0x20, 0x10, 0x0f, 0x00, //V
-0x7f, 0x20, 0x10, 0x08, 0x10, 0x20, 0x7f, 0x00, //W
-0x00, 0x41, 0x22, 0x14, 0x14, 0x22, 0x41, 0x00, //X
-0x01, 0x02, 0x04, 0x78, 0x04, 0x02, 0x01, 0x00, //Y
-0x41, 0x61, 0x59, 0x45, 0x43, 0x41, 0x00, 0x00, //Z
-0x3e, 0x41, 0x41, 0x49, 0x41, 0x41, 0x3e, 0x00, //0
-0x00, 0x00, 0x42, 0x7f, 0x40, 0x00, 0x00, 0x00, //1
-0x30, 0x49, 0x49, 0x49, 0x49, 0x46, 0x00, 0x00, //2
-0x49, 0x49, 0x49, 0x49, 0x49, 0x49, 0x36, 0x00, //3
-0x3f, 0x20, 0x20, 0x78, 0x20, 0x20, 0x00, 0x00, //4
-0x4f, 0x49, 0x49, 0x49, 0x49, 0x30, 0x00, 0x00, //5
-0x3f, 0x48, 0x48, 0x48, 0x48, 0x48, 0x30, 0x00, //6
-0x01, 0x01, 0x01, 0x61, 0x31, 0x0d, 0x03, 0x00, //7
-0x36, 0x49, 0x49, 0x49, 0x49, 0x49, 0x36, 0x00, //8
-0x06, 0x09, 0x09, 0x09, 0x09, 0x09, 0x7f, 0x00, //9
-0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C,//just a line 
-0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x00, //slash
-0x00, 0x00, 0x39, 0x39, 0x00, 0x00, 0x00, 0x00, //exclamation mark
-0x00, 0x00, 0x38, 0x0D, 0x18, 0x00, 0x00, 0x00 //question mark
+#include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Everything the text renderer needs to know about a font. Glyphs are in the display's page format, one after
+/// the other, each `width` columns of ((height + 7) / 8) bytes. Proportional fonts say where each glyph's ink
+/// starts and how wide it is, fixed width ones leave those NULL and every glyph is the full width
+struct ssd1306_font {
+    const uint8_t *glyphs;
+    const uint8_t *map;     // 128 entries, character to glyph number, NULL if the glyphs are in order from `first`
+    const uint8_t *left;    // per glyph, blank columns to skip at the start
+    const uint8_t *advance; // per glyph, columns to draw
+    uint8_t width, height;
+    uint8_t first, count;
+    uint8_t spacing;        // blank columns after every glyph
 };
+
+// All of these cover printable ASCII (space to '~') in order, so finding a glyph is one subtraction. The tables
+// get built at compile time in ssd1306_font.cpp and are const, so they stay in flash
+extern const struct ssd1306_font ssd1306_font_8x8;              // the original capitals and digits, the rest from the 5x7
+extern const struct ssd1306_font ssd1306_font_8x8_proportional; // same glyphs, trimmed to their ink
+extern const struct ssd1306_font ssd1306_font_5x7;              // 5x7 glyphs in 6 wide cells
+extern const struct ssd1306_font ssd1306_font_5x7_proportional;
+extern const struct ssd1306_font ssd1306_font_16;               // the 8x8 doubled up, 16x16
+extern const struct ssd1306_font ssd1306_font_16_proportional;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -11,8 +11,15 @@
  #include <math.h>
  #include "pico/stdlib.h"
  #include "pico/binary_info.h"
+ #if !PICO_NO_HARDWARE
  #include "hardware/i2c.h"
+ #include "hardware/dma.h"
+ #include "hardware/irq.h"
+ #include "hardware/sync.h"
+ #include "pico/multicore.h"
+ #endif
  #include "ssd1306_font.h"
+ #include "ssd1306_transport.h"
  
  
  /* Example code to talk to an SSD1306-based OLED display
@@ -46,6 +53,7 @@
  
  // 400 is usual, but often these can be overclocked to improve display response.
  // Tested at 1000 on both 32 and 84 pixel height devices and it worked.
+ // For faster than the i2c block will go, see SSD1306_use_pio_bus in ssd1306_pio.c
  #define SSD1306_I2C_CLK             400
  //#define SSD1306_I2C_CLK             1000
  
@@ -82,6 +90,19 @@
  #define SSD1306_NUM_PAGES           (SSD1306_HEIGHT / SSD1306_PAGE_HEIGHT)
  #define SSD1306_BUF_LEN             (SSD1306_NUM_PAGES * SSD1306_WIDTH)
  
+ // bytes of bus traffic it costs to open a render window before any data goes out.
+ // the address byte, 6 address commands each with a control byte in front, then the data control byte
+ #define SSD1306_WINDOW_OVERHEAD     (1 + 6 * 2 + 1)
+
+ // most commands that can go in front of a data payload in one transaction
+ #define SSD1306_MAX_INLINE_CMDS     16
+
+ // most windows a single flush will split into before it gives up and sends one box
+ #define SSD1306_MAX_WINDOWS         32
+
+ // i2c data_cmd words the async flush can queue up, a full frame plus a window header for every window
+ #define SSD1306_DMA_WORDS           (SSD1306_BUF_LEN + SSD1306_MAX_WINDOWS * (SSD1306_MAX_INLINE_CMDS * 2 + 2))
+
  #define SSD1306_WRITE_MODE         _u(0xFE)
  #define SSD1306_READ_MODE          _u(0xFF)
  
@@ -95,52 +116,397 @@
      int buflen;
  };
 
- uint8_t bufferGlobal[1024] = { (uint8_t)0 };
+ // Two framebuffers. bufferGlobal always points at the back one, which is what everything draws into,
+ // frontBuffer is the last finished frame and is what the transport reads from. SwapBuffers flips the pointers
+ static uint8_t framebuffers[2][SSD1306_BUF_LEN] = { { (uint8_t)0 } };
+
+ uint8_t *bufferGlobal = framebuffers[0];
+ static uint8_t *frontBuffer = framebuffers[1];
+
+ // Dirty tracking for bufferGlobal. Each page keeps the inclusive column range that has
+ // changed since the last SwapBuffers(), start > end means the page is clean.
+ // Everything starts dirty as we have no idea what's in the panels RAM after power up
+ static int dirtyStartCol[SSD1306_NUM_PAGES] = { [0 ... SSD1306_NUM_PAGES - 1] = 0 };
+ static int dirtyEndCol[SSD1306_NUM_PAGES] = { [0 ... SSD1306_NUM_PAGES - 1] = SSD1306_WIDTH - 1 };
+
+ // Same thing for the front buffer, what it has that the panel doesn't yet. SwapBuffers moves the back buffers
+ // ranges over here and the flush clears them, so drawing and flushing never touch the same ranges
+ static int frontDirtyStartCol[SSD1306_NUM_PAGES] = { [0 ... SSD1306_NUM_PAGES - 1] = SSD1306_WIDTH };
+ static int frontDirtyEndCol[SSD1306_NUM_PAGES] = { [0 ... SSD1306_NUM_PAGES - 1] = -1 };
+
+ // volatile as with the display core running these get written on core 1 and read on core 0
+ static volatile int lastFlushBytes = 0;
+ static volatile int lastFlushWindows = 0;
+
+ // Copy of what should be in the panels GDDRAM, everything that goes out through render() lands in here too.
+ // The flush diffs the front buffer against it so only bytes that are actually different get sent
+ static uint8_t shadowBuffer[SSD1306_BUF_LEN];
+ static volatile bool shadowValid = false;
+
+ static void ShadowStore(const uint8_t *buf, int stride, struct render_area *area) {
+     // an area hanging off the 128 x 8 panel (DisplayImage makes those) wraps around the panels RAM in ways the
+     // shadow can't follow, so don't store it and stop trusting the shadow instead
+     if (area->end_col >= SSD1306_WIDTH || area->end_page >= SSD1306_NUM_PAGES ||
+         area->start_col > area->end_col || area->start_page > area->end_page) {
+         shadowValid = false;
+         return;
+     }
+
+     int width = area->end_col - area->start_col + 1;
+
+     for (int page = area->start_page; page <= area->end_page; page++) {
+         memcpy(shadowBuffer + page * SSD1306_WIDTH + area->start_col, buf + (page - area->start_page) * stride, width);
+     }
+ }
+
+ /// @brief forget what we think is on the panel, the next flush sends the whole frame. For if something else
+ /// has been talking to the display
+ void InvalidateShadow() {
+     shadowValid = false;
+ }
+
+ /// @brief marks a window of bufferGlobal as changed, in columns and pages (inclusive). Anything off screen is clamped
+ void MarkDirty(int startCol, int endCol, int startPage, int endPage) {
+     if (startCol < 0) startCol = 0;
+     if (endCol > SSD1306_WIDTH - 1) endCol = SSD1306_WIDTH - 1;
+     if (startPage < 0) startPage = 0;
+     if (endPage > (int)SSD1306_NUM_PAGES - 1) endPage = SSD1306_NUM_PAGES - 1;
+
+     if (startCol > endCol || startPage > endPage) return;
+
+     for (int page = startPage; page <= endPage; page++) {
+         if (startCol < dirtyStartCol[page]) dirtyStartCol[page] = startCol;
+         if (endCol > dirtyEndCol[page]) dirtyEndCol[page] = endCol;
+     }
+ }
+
+ /// @brief same as MarkDirty but takes pixel coordinates (inclusive) and works out the pages itself
+ void MarkDirtyPixels(int xStart, int xEnd, int yStart, int yEnd) {
+     if (yStart < 0) yStart = 0;
+     if (yEnd < yStart) return;
+
+     MarkDirty(xStart, xEnd, yStart / SSD1306_PAGE_HEIGHT, yEnd / SSD1306_PAGE_HEIGHT);
+ }
+
+ /// @brief for when something writes straight into bufferGlobal and doesn't want to work out what it touched
+ void MarkAllDirty() {
+     MarkDirty(0, SSD1306_WIDTH - 1, 0, SSD1306_NUM_PAGES - 1);
+ }
+
+ // set by SetFullRedraw, SwapBuffers leaves the new back buffer stale instead of copying the frame back into it
+ static bool fullRedraw = false;
+
+ /// @brief for when every frame gets drawn from scratch (cleared and everything redrawn), so SwapBuffers can skip
+ /// copying the last frame back into the new back buffer. Whatever's in bufferGlobal after a swap is then two
+ /// frames old, so only turn this on if nothing relies on what was drawn last frame
+ void SetFullRedraw(bool on) {
+     fullRedraw = on;
+ }
+
+ /// @brief Makes the back buffer the front one and vice versa by swapping the pointers. The dirty windows (what
+ /// changed since the last swap) need sending, and they're also the only places the new back buffer is out of
+ /// date, so those bytes get copied back across to keep drawing incremental. That copy is as big as what
+ /// changed, up to the whole frame, and SetFullRedraw skips it.
+ /// Don't call this while the front buffer is still being sent
+ void SwapBuffers() {
+     uint8_t *finished = bufferGlobal;
+     bufferGlobal = frontBuffer;
+     frontBuffer = finished;
+
+     for (int page = 0; page < (int)SSD1306_NUM_PAGES; page++) {
+         if (dirtyStartCol[page] > dirtyEndCol[page]) continue;
+
+         int offset = page * SSD1306_WIDTH + dirtyStartCol[page];
+         if (!fullRedraw) memcpy(bufferGlobal + offset, frontBuffer + offset, dirtyEndCol[page] - dirtyStartCol[page] + 1);
+
+         if (dirtyStartCol[page] < frontDirtyStartCol[page]) frontDirtyStartCol[page] = dirtyStartCol[page];
+         if (dirtyEndCol[page] > frontDirtyEndCol[page]) frontDirtyEndCol[page] = dirtyEndCol[page];
+
+         dirtyStartCol[page] = SSD1306_WIDTH;
+         dirtyEndCol[page] = -1;
+     }
+ }
+
+ /// @brief the buffer the display is being fed from, don't draw into this
+ const uint8_t *GetFrontBuffer() {
+     return frontBuffer;
+ }
+
+ /// @brief how many bytes of framebuffer the last UpdateFromGlobal() actually sent, 0 if nothing had changed
+ int GetLastFlushBytes() {
+     return lastFlushBytes;
+ }
+
+ /// @brief how many windows the last flush was split into
+ int GetLastFlushWindows() {
+     return lastFlushWindows;
+ }
 
  void calc_render_area_buflen(struct render_area *area) {
      // calculate how long the flattened buffer will be for a render area
      area->buflen = (area->end_col - area->start_col + 1) * (area->end_page - area->start_page + 1);
  }
  
+ // Bus accounting. wire bytes count everything after the start condition including the address byte,
+ // legacy is what the same traffic would have cost the old way of one transaction per command byte
+ static uint32_t busTransactions = 0;
+ static uint32_t busWireBytes = 0;
+ static uint32_t busLegacyWireBytes = 0;
+
+ // The fence counters say which flush has gone out completely. Only the async DMA flush ever leaves them apart
+ static volatile uint32_t flushIssued = 0;
+ static volatile uint32_t flushCompleted = 0;
+
+ // flushes that got cut off (a NACK or some other TX abort), and the fence of the last one
+ static volatile uint32_t flushFailures = 0;
+ static volatile uint32_t lastFailedFence = 0;
+
+ /// @brief true once the flush that returned this fence has completely gone out on the bus
+ bool FlushFenceReached(uint32_t fence) {
+     return (int32_t)(flushCompleted - fence) >= 0;
+ }
+
+ /// @brief true if the flush that returned this fence got aborted partway, the panel is missing some of that frame.
+ /// The next flush sends the whole frame to make up for it
+ bool FlushFailed(uint32_t fence) {
+     return flushFailures != 0 && lastFailedFence == fence;
+ }
+
+ uint32_t GetFlushFailures() {
+     return flushFailures;
+ }
+
+ /// @brief waits for the flush that returned this fence to finish
+ /// @return false if it got aborted rather than going out completely
+ bool FlushWait(uint32_t fence) {
+     while (!FlushFenceReached(fence))
+         tight_loop_contents();
+
+     return !FlushFailed(fence);
+ }
+
+ bool FlushBusy() {
+     return flushCompleted != flushIssued;
+ }
+
  #ifdef i2c_default
- 
+
+ // Async flush state. While dmaWordCount is >= 0 the i2c transport doesn't touch the hardware, it encodes
+ // into dmaWords instead, which then gets fed into the TX FIFO by a DMA channel
+ static uint16_t dmaWords[SSD1306_DMA_WORDS];
+ static int dmaWordCount = -1;
+ static int dmaChannel = -1;
+
+ static void (*flushCallback)(void) = NULL;
+
+ static void SSD1306_i2c_irq() {
+     i2c_hw_t *hw = i2c_get_hw(i2c_default);
+
+     if (!(hw->intr_stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS)) return;
+
+     // an abort ends in a STOP too, but the DMA would still be feeding the rest of the frame in. Stop it, and as
+     // the panel is now missing part of the frame the shadow can't be trusted either
+     if (hw->tx_abrt_source) {
+         dma_channel_abort(dmaChannel);
+         (void)hw->clr_tx_abrt;
+
+         lastFailedFence = flushIssued;
+         flushFailures++;
+         shadowValid = false;
+     }
+     (void)hw->clr_stop_det;
+     hw->intr_mask = 0;
+
+     i2c_default->restart_on_next = false;
+     flushCompleted = flushIssued;
+
+     //clear it before calling in case the callback kicks off the next flush
+     void (*callback)(void) = flushCallback;
+     flushCallback = NULL;
+     if (callback) callback();
+ }
+
+ static void SSD1306_dma_init() {
+     if (dmaChannel >= 0) return;
+
+     dmaChannel = dma_claim_unused_channel(true);
+
+     i2c_hw_t *hw = i2c_get_hw(i2c_default);
+     hw->intr_mask = 0; // only STOP_DET, and only while an async flush is out
+     hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS;
+
+     int irq = I2C0_IRQ + i2c_hw_index(i2c_default);
+     irq_set_exclusive_handler(irq, SSD1306_i2c_irq);
+     irq_set_enabled(irq, true);
+ }
+
+ // The hardware i2c transport. This pokes the i2c block directly the same way i2c_write_blocking does
+ // internally, so the pieces of a transaction go straight into the TX FIFO without being glued together in a
+ // temporary buffer first. Only the very last byte carries the STOP.
+ static void SSD1306_i2c_write(void *ctx, const uint8_t *head, int headLen, const uint8_t *buf, int width, int rows, int stride) {
+     int total = headLen + width * rows;
+     int sent = 0;
+
+     if (dmaWordCount >= 0) {
+         // encoding for the async flush. Every transaction after the first starts with a restart,
+         // the STOP goes on the very last word once everything is queued up
+         assert(dmaWordCount + total <= SSD1306_DMA_WORDS);
+
+         for (int i = -headLen; i < width * rows; i++) {
+             uint16_t word = (i < 0) ? head[headLen + i] : buf[(i / width) * stride + (i % width)];
+
+             if (sent == 0 && (dmaWordCount > 0 || i2c_default->restart_on_next)) word |= I2C_IC_DATA_CMD_RESTART_BITS;
+
+             dmaWords[dmaWordCount++] = word;
+             sent++;
+         }
+         return;
+     }
+
+     // can't share the bus with a flush that's still going
+     while (FlushBusy())
+         tight_loop_contents();
+
+     i2c_hw_t *hw = i2c_get_hw(i2c_default);
+
+     hw->enable = 0;
+     hw->tar = SSD1306_I2C_ADDR;
+     hw->enable = 1;
+
+     for (int i = -headLen; i < width * rows; i++) {
+         uint32_t cmd = (i < 0) ? head[headLen + i] : buf[(i / width) * stride + (i % width)];
+
+         // the rest of the driver leaves the bus held between transactions, so pick up with a restart
+         if (sent == 0 && i2c_default->restart_on_next) cmd |= I2C_IC_DATA_CMD_RESTART_BITS;
+         if (sent == total - 1) cmd |= I2C_IC_DATA_CMD_STOP_BITS;
+
+         while (!i2c_get_write_available(i2c_default))
+             tight_loop_contents();
+
+         hw->data_cmd = cmd;
+         sent++;
+     }
+
+     // wait for the STOP to go out (an abort also ends in a STOP), then tidy up the flags
+     while (!(hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_STOP_DET_BITS))
+         tight_loop_contents();
+
+     if (hw->tx_abrt_source) {
+         (void)hw->clr_tx_abrt;
+         shadowValid = false; //some of it never made it
+     }
+     (void)hw->clr_stop_det;
+
+     i2c_default->restart_on_next = false;
+ }
+
+ const struct ssd1306_transport ssd1306_i2c_transport = { SSD1306_i2c_write, NULL };
+
+ static const struct ssd1306_transport *transport = &ssd1306_i2c_transport;
+
+ #else
+
+ static const struct ssd1306_transport *transport = NULL;
+
+ #endif
+
+ /// @brief sends everything through this from now on, e.g. the simulator in ssd1306_sim.h
+ void SSD1306_set_transport(const struct ssd1306_transport *newTransport) {
+     FlushWait(flushIssued);
+     transport = newTransport;
+ }
+
+ const struct ssd1306_transport *SSD1306_get_transport() {
+     return transport;
+ }
+
+ // Writes a single bus transaction made of a short header (control byte and maybe some commands) followed by
+ // `rows` runs of `width` bytes, each run `stride` bytes apart in buf, through whatever transport is set
+ static void SSD1306_write_strided(const uint8_t *head, int headLen, const uint8_t *buf, int width, int rows, int stride) {
+     assert(transport);
+
+     busTransactions++;
+     busWireBytes += 1 + headLen + width * rows; // address byte + everything after it
+
+     transport->write(transport->ctx, head, headLen, buf, width, rows, stride);
+ }
+
  void SSD1306_send_cmd(uint8_t cmd) {
      // I2C write process expects a control byte followed by data
      // this "data" can be a command or data to follow up a command
      // Co = 1, D/C = 0 => the driver expects a command
      uint8_t buf[2] = {0x80, cmd};
-     i2c_write_blocking(i2c_default, SSD1306_I2C_ADDR, buf, 2, true);
+
+     busLegacyWireBytes += 3;
+     SSD1306_write_strided(buf, 2, NULL, 0, 0, 0);
  }
  
- void SSD1306_send_cmd_list(uint8_t *buf, int num) {
-    for (int i=0;i<num;i++){
-        SSD1306_send_cmd(buf[i]);
-    }
+ void SSD1306_send_cmd_list(const uint8_t *buf, int num) {
+    // Co = 0, D/C = 0 => everything after the control byte is a command, so the whole list
+    // goes out in one transaction instead of one per byte
+    static const uint8_t control = 0x00;
 
+    busLegacyWireBytes += num * 3;
+    SSD1306_write_strided(&control, 1, buf, num, 1, num);
  }
- 
- void SSD1306_send_buf(uint8_t buf[], int buflen) {
+
+ void SSD1306_send_buf(const uint8_t buf[], int buflen) {
      // in horizontal addressing mode, the column address pointer auto-increments
      // and then wraps around to the next page, so we can send the entire frame
      // buffer in one gooooooo!
- 
-     // copy our frame buffer into a new buffer because we need to add the control byte
-     // to the beginning
 
+     // the data control byte goes out in front of the buffer as part of the same transaction,
+     // no copying needed
+     static const uint8_t control = 0x40;
 
- 
-     uint8_t *temp_buf = malloc(buflen + 1);
- 
-     temp_buf[0] = 0x40;
+     busLegacyWireBytes += 2 + buflen;
+     SSD1306_write_strided(&control, 1, buf, buflen, 1, buflen);
+ }
 
-     memcpy(temp_buf+1, buf, buflen);
+ /// @brief sends a window that lives inside a bigger buffer, `stride` is how wide a page is in that buffer
+ void SSD1306_send_buf_strided(const uint8_t *buf, int width, int pages, int stride) {
+     static const uint8_t control = 0x40;
 
+     busLegacyWireBytes += 2 + width * pages;
+     SSD1306_write_strided(&control, 1, buf, width, pages, stride);
+ }
 
-     i2c_write_blocking(i2c_default, SSD1306_I2C_ADDR, temp_buf, buflen + 1, true);
+ uint32_t GetBusTransactions() {
+     return busTransactions;
+ }
 
-     free(temp_buf);
+ uint32_t GetBusWireBytes() {
+     return busWireBytes;
  }
- 
+
+ /// @brief how many bytes batching has saved over sending one command per transaction, since boot or the last reset
+ uint32_t GetBusWireBytesSaved() {
+     return busLegacyWireBytes - busWireBytes;
+ }
+
+ void ResetBusStats() {
+     busTransactions = 0;
+     busWireBytes = 0;
+     busLegacyWireBytes = 0;
+ }
+
+ /// @brief commands followed by data, all in one transaction. Each command gets a Co = 1 control byte in front
+ /// of it so the display goes back to looking for a control byte afterwards, then 0x40 switches over to data
+ void SSD1306_send_cmds_and_buf(const uint8_t *cmds, int num, const uint8_t *buf, int width, int pages, int stride) {
+     assert(num <= SSD1306_MAX_INLINE_CMDS);
+
+     uint8_t head[SSD1306_MAX_INLINE_CMDS * 2 + 1];
+
+     for (int i = 0; i < num; i++) {
+         head[i * 2] = 0x80;
+         head[i * 2 + 1] = cmds[i];
+     }
+     head[num * 2] = 0x40;
+
+     busLegacyWireBytes += num * 3 + 2 + width * pages;
+     SSD1306_write_strided(head, num * 2 + 1, buf, width, pages, stride);
+ }
+
  void SSD1306_init() {
      // Some of these commands are not strictly necessary as the reset
      // process defaults to some of these but they are shown here
@@ -207,7 +573,24 @@
      SSD1306_send_cmd_list(cmds, count_of(cmds));
  }
  
- void render(uint8_t *buf, struct render_area *area, bool overRide) {
+ /// @brief same as render, but buf is a bigger image `stride` bytes wide that the area gets picked out of
+ void render_strided(const uint8_t *buf, int stride, struct render_area *area) {
+    uint8_t cmds[] = {
+        SSD1306_SET_COL_ADDR,
+        area->start_col,
+        area->end_col,
+        SSD1306_SET_PAGE_ADDR,
+        area->start_page,
+        area->end_page
+    };
+
+    SSD1306_send_cmds_and_buf(cmds, count_of(cmds), buf, area->end_col - area->start_col + 1,
+                              area->end_page - area->start_page + 1, stride);
+
+    ShadowStore(buf, stride, area);
+ }
+
+ void render(const uint8_t *buf, struct render_area *area, bool overRide) {
      // update a portion of the display with a render area
     uint8_t cmds[] = {
         SSD1306_SET_COL_ADDR,
@@ -268,162 +651,796 @@
 
     //this probably remains the same, we're adjusting the buffer passed here and then adjusting the main buffer
     //after
-    SSD1306_send_cmd_list(cmds, count_of(cmds));
+    //window setup and the data go out as a single transaction
+    SSD1306_send_cmds_and_buf(cmds, count_of(cmds), buf, area->buflen, 1, area->buflen);
 
-    SSD1306_send_buf(buf, area->buflen);
+    ShadowStore(buf, area->end_col - area->start_col + 1, area);
  }
 
- void UpdateFromGlobal(){
- 
-    struct render_area frame_area = {
-        start_col: 0,
-        end_col : SSD1306_WIDTH - 1,
-        start_page : 0,
-        end_page : SSD1306_NUM_PAGES - 1
+ static void FlushWindow(int startCol, int endCol, int startPage, int endPage) {
+    struct render_area area = {
+        start_col: startCol,
+        end_col : endCol,
+        start_page : startPage,
+        end_page : endPage
     };
-    
-    calc_render_area_buflen(&frame_area);
 
+    calc_render_area_buflen(&area);
+
+    //the window gets picked straight out of the front buffer page by page, so no staging copy
+    render_strided(frontBuffer + (startPage * SSD1306_WIDTH) + startCol, SSD1306_WIDTH, &area);
+
+    lastFlushBytes += area.buflen;
+    lastFlushWindows++;
+ }
+
+ static int WindowCost(struct render_area *area) {
+    return (area->end_col - area->start_col + 1) * (area->end_page - area->start_page + 1) + SSD1306_WINDOW_OVERHEAD;
+ }
+
+ // Works out the cheapest set of windows that brings the panel up to date with the front buffer, only looking
+ // inside the front buffers dirty ranges. Every window costs SSD1306_WINDOW_OVERHEAD on top of its bytes, so:
+ //  - within a page, changed runs get joined if the gap between them is cheaper to resend than opening a new window
+ //  - going down the pages, a run gets folded into a window from the page above if the bigger window is cheaper than two
+ //  - if one box around everything beats all of that, it's just the box
+ // Returns how many windows it filled in, 0 if nothing actually changed
+ static int PlanWindows(struct render_area *windows, int maxWindows) {
+    int count = 0;
+    bool extended[SSD1306_MAX_WINDOWS];
+
+    struct render_area box = { start_col: SSD1306_WIDTH, end_col: 0, start_page: SSD1306_NUM_PAGES, end_page: 0 };
+    bool anything = false;
+    bool overflow = false;
+
+    for (int page = 0; page < (int)SSD1306_NUM_PAGES; page++) {
+        if (frontDirtyStartCol[page] > frontDirtyEndCol[page]) continue;
+
+        for (int w = 0; w < count; w++) extended[w] = false;
+
+        const uint8_t *front = frontBuffer + page * SSD1306_WIDTH;
+        const uint8_t *shadow = shadowBuffer + page * SSD1306_WIDTH;
+
+        int col = frontDirtyStartCol[page];
+        int end = frontDirtyEndCol[page];
+
+        while (col <= end) {
+            if (front[col] == shadow[col]) { col++; continue; }
+
+            // found a change, keep going while the next change is close enough that the gap is cheaper than a new window
+            int runStart = col;
+            int runEnd = col;
+
+            for (col++; col <= end; col++) {
+                if (front[col] == shadow[col]) continue;
+                if (col - runEnd - 1 >= SSD1306_WINDOW_OVERHEAD) break;
+                runEnd = col;
+            }
+
+            anything = true;
+            if (runStart < box.start_col) box.start_col = runStart;
+            if (runEnd > box.end_col) box.end_col = runEnd;
+            if (page < box.start_page) box.start_page = page;
+            box.end_page = page;
+
+            if (overflow) continue;
+
+            struct render_area run = { start_col: runStart, end_col: runEnd, start_page: page, end_page: page };
+
+            // best window from the page above to grow down into this run, if any of them are worth it
+            int best = -1;
+            int bestSaving = -1;
+
+            for (int w = 0; w < count; w++) {
+                if (windows[w].end_page != page - 1 || extended[w]) continue;
+
+                struct render_area merged = {
+                    start_col: windows[w].start_col < runStart ? windows[w].start_col : runStart,
+                    end_col: windows[w].end_col > runEnd ? windows[w].end_col : runEnd,
+                    start_page: windows[w].start_page,
+                    end_page: page
+                };
+
+                int saving = WindowCost(&windows[w]) + WindowCost(&run) - WindowCost(&merged);
+                if (saving > bestSaving) {
+                    best = w;
+                    bestSaving = saving;
+                }
+            }
+
+            if (best >= 0) {
+                if (runStart < windows[best].start_col) windows[best].start_col = runStart;
+                if (runEnd > windows[best].end_col) windows[best].end_col = runEnd;
+                windows[best].end_page = page;
+                extended[best] = true;
+            } else if (count < maxWindows) {
+                windows[count] = run;
+                extended[count] = true;
+                count++;
+            } else {
+                overflow = true; //too fragmented to bother, the box will do
+            }
+        }
+    }
+
+    if (!anything) return 0;
+
+    int total = 0;
+    for (int w = 0; w < count; w++) total += WindowCost(&windows[w]);
+
+    if (overflow || WindowCost(&box) <= total) {
+        windows[0] = box;
+        count = 1;
+    }
+
+    return count;
+ }
+
+ static void FlushDirty(){
+
+    lastFlushWindows = 0;
+
+    if (!shadowValid) {
+        //no idea what the panel has, so all of it
+        FlushWindow(0, SSD1306_WIDTH - 1, 0, SSD1306_NUM_PAGES - 1);
+        shadowValid = true;
+    } else {
+        struct render_area windows[SSD1306_MAX_WINDOWS];
+        int count = PlanWindows(windows, SSD1306_MAX_WINDOWS);
+
+        for (int w = 0; w < count; w++) {
+            FlushWindow(windows[w].start_col, windows[w].end_col, windows[w].start_page, windows[w].end_page);
+        }
+    }
+
+    for (int page = 0; page < (int)SSD1306_NUM_PAGES; page++) {
+        frontDirtyStartCol[page] = SSD1306_WIDTH;
+        frontDirtyEndCol[page] = -1;
+    }
+ }
+
+ /// @brief flips what's been drawn to the front and sends whatever has changed since the last call, and waits for it
+ void UpdateFromGlobal(){
+    lastFlushBytes = 0;
+
+    SwapBuffers();
+
+    FlushDirty();
+ }
+
+ /// @brief Same as UpdateFromGlobal but returns straight away while a DMA channel feeds the i2c block.
+ /// The changed windows get encoded into their own buffer first, so bufferGlobal is free to draw into as soon
+ /// as this returns. If the previous flush is still going this waits for it first.
+ /// On any other transport this just does a blocking flush and hands back a fence that's already reached
+ /// @param onComplete optional, called from the i2c interrupt once the frame is fully out (or got aborted, check
+ /// FlushFailed with the fence). Keep it short
+ /// @return a fence for FlushFenceReached/FlushWait
+ uint32_t UpdateFromGlobalAsync(void (*onComplete)(void)){
+#ifdef i2c_default
+    if (transport == &ssd1306_i2c_transport) {
+        SSD1306_dma_init();
+
+        FlushWait(flushIssued);
+
+        lastFlushBytes = 0;
+
+        SwapBuffers();
+
+        dmaWordCount = 0;
+        FlushDirty();
+        int count = dmaWordCount;
+        dmaWordCount = -1;
+
+        if (count == 0) { //nothing changed, so nothing to wait for
+            if (onComplete) onComplete();
+            return flushIssued;
+        }
+
+        dmaWords[count - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+        i2c_hw_t *hw = i2c_get_hw(i2c_default);
+
+        hw->enable = 0;
+        hw->tar = SSD1306_I2C_ADDR;
+        hw->enable = 1;
+
+        (void)hw->clr_stop_det;
+
+        flushCallback = onComplete;
+        flushIssued++;
+
+        hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS;
+
+        dma_channel_config config = dma_channel_get_default_config(dmaChannel);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+        channel_config_set_read_increment(&config, true);
+        channel_config_set_write_increment(&config, false);
+        channel_config_set_dreq(&config, i2c_get_dreq(i2c_default, true));
+
+        dma_channel_configure(dmaChannel, &config, &hw->data_cmd, dmaWords, count, true);
 
-    render(bufferGlobal, &frame_area, false);
+        return flushIssued;
+    }
+#endif
+
+    UpdateFromGlobal();
+
+    flushCompleted = ++flushIssued;
+    if (onComplete) onComplete();
+
+    return flushIssued;
+ }
+
+ #if !PICO_NO_HARDWARE
+
+ // Pipeline mode. Core 1 owns the display, core 0 draws. Core 0 swaps the buffers and pushes the frame number
+ // through the multicore FIFO, core 1 sends the front buffer and pushes the number back once it's done with it.
+ // Only one frame is ever in flight as the front buffer is read straight out of by the transport
+ static volatile bool displayCoreRunning = false;
+ static bool framePending = false;
+ static uint32_t pipelineFrame = 0;
+
+ // utilization, in microseconds since ResetPipelineStats. Core 0 counts the time from the start of each frame
+ // (PipelineFrameStart, or the last flush if nobody calls it) to handing it over, core 1 counts time spent
+ // actually sending
+ static uint64_t pipelineStartUs = 0;
+ static uint64_t core0FrameStartUs = 0;
+ static volatile uint64_t core0BusyUs = 0;
+ static volatile uint64_t core1BusyUs = 0;
+ static volatile uint32_t pipelineFrames = 0;
+
+ static void DisplayCoreLoop() {
+     while (true) {
+         uint32_t frame = multicore_fifo_pop_blocking();
+         __dmb(); // see everything core 0 wrote before handing the frame over
+
+         uint64_t start = time_us_64();
+
+         lastFlushBytes = 0;
+         FlushDirty();
+
+         core1BusyUs += time_us_64() - start;
+         pipelineFrames++;
+
+         __dmb(); // and have the flush stats and shadow written out before core 0 hears it's done
+         multicore_fifo_push_blocking(frame);
+     }
+ }
+
+ void ResetPipelineStats() {
+     pipelineStartUs = time_us_64();
+     core0FrameStartUs = pipelineStartUs;
+     core0BusyUs = 0;
+     core1BusyUs = 0;
+     pipelineFrames = 0;
+ }
+
+ /// @brief hands the display over to core 1. After this use UpdateFromGlobalPipelined (Update() does it for you)
+ /// and don't use UpdateFromGlobal/UpdateFromGlobalAsync, as they'd fight core 1 for the bus
+ void StartDisplayCore() {
+     if (displayCoreRunning) return;
+
+     FlushWait(flushIssued);
+
+     ResetPipelineStats();
+     multicore_launch_core1(DisplayCoreLoop);
+     displayCoreRunning = true;
+ }
+
+ bool DisplayCoreRunning() {
+     return displayCoreRunning;
+ }
+
+ /// @brief waits for core 1 to be done with the last frame (if it isn't already), flips and hands the new frame
+ /// over, then returns without waiting for it to be sent
+ void UpdateFromGlobalPipelined() {
+     core0BusyUs += time_us_64() - core0FrameStartUs; // drawing the frame
+
+     if (framePending) {
+         multicore_fifo_pop_blocking();
+         __dmb();
+         framePending = false;
+     }
+
+     uint64_t start = time_us_64();
+
+     SwapBuffers();
+
+     __dmb(); // the swapped buffers and dirty ranges have to be out before core 1 starts on them
+     multicore_fifo_push_blocking(++pipelineFrame);
+     framePending = true;
+
+     core0FrameStartUs = time_us_64();
+     core0BusyUs += core0FrameStartUs - start; // the flip
+ }
+
+ /// @brief the frame core 0 is about to draw starts now. Update() calls this after its frame pacing sleep so the
+ /// sleep doesn't count as work, without it core 0's frame starts as soon as the last one is handed over
+ void PipelineFrameStart() {
+     core0FrameStartUs = time_us_64();
+ }
+
+ /// @brief percentage of time the core has spent doing useful work since the last reset. For core 0 that's
+ /// drawing frames and flipping them, not waiting on core 1 or sleeping between frames, for core 1 that's sending
+ float GetCoreUtilization(int core) {
+     uint64_t elapsed = time_us_64() - pipelineStartUs;
+     if (elapsed == 0) return 0;
+
+     uint64_t busy = (core == 0) ? core0BusyUs : core1BusyUs;
+
+     return 100.0f * (float)busy / (float)elapsed;
+ }
+
+ /// @brief frames core 1 has finished sending per second since the last reset
+ float GetPipelineFps() {
+     uint64_t elapsed = time_us_64() - pipelineStartUs;
+     if (elapsed == 0) return 0;
+
+     return pipelineFrames * 1000000.0f / (float)elapsed;
+ }
+
+ #else
+
+ // no second core on the host build, the pipelined flush is just the blocking one
+ void StartDisplayCore() {}
+
+ bool DisplayCoreRunning() {
+     return false;
+ }
+
+ void UpdateFromGlobalPipelined() {
+     UpdateFromGlobal();
+ }
+
+ void PipelineFrameStart() {}
+
+ void ResetPipelineStats() {}
 
+ float GetCoreUtilization(int core) {
+     (void)core;
+     return 0;
+ }
 
+ float GetPipelineFps() {
+     return 0;
  }
+
+ #endif
  
  void SetPixel(uint8_t *buf, int x,int y, bool on) {
-     assert(x >= 0 && x < SSD1306_WIDTH && y >=0 && y < SSD1306_HEIGHT);
- 
-     // The calculation to determine the correct bit to set depends on which address
-     // mode we are in. This code assumes horizontal
- 
      // The video ram on the SSD1306 is split up in to 8 rows, one bit per pixel.
      // Each row is 128 long by 8 pixels high, each byte vertically arranged, so byte 0 is x=0, y=0->7,
-     // byte 1 is x = 1, y=0->7 etc
- 
-     // This code could be optimised, but is like this for clarity. The compiler
-     // should do a half decent job optimising it anyway.
+     // byte 1 is x = 1, y=0->7 etc. Anything off screen just gets ignored
+     if (x < 0 || x >= SSD1306_WIDTH || y < 0 || y >= SSD1306_HEIGHT) return;
+
+     uint8_t *byte = &buf[(y >> 3) * SSD1306_WIDTH + x];
 
-     if(x < 0 || x > 128 || y < 0 || y > 63) return;
- 
-     const int BytesPerRow = SSD1306_WIDTH ; // x pixels, 1bpp, but each row is 8 pixel high, so (x / 8) * 8
- 
-     int byte_idx = (y / 8) * BytesPerRow + x;
-     uint8_t byte = buf[byte_idx];
- 
      if (on)
-        byte |=  1 << (y % 8);
+        *byte |= 1 << (y & 7);
      else
-        byte &= ~(1 << (y % 8));
- 
-     buf[byte_idx] = byte;
+        *byte &= ~(1 << (y & 7));
+
+     if (buf == bufferGlobal) MarkDirty(x, x, y >> 3, y >> 3);
+ }
+
+ /*
+  Span primitives. Everything here works on whole bytes: a horizontal span is the same bit in a run of column bytes,
+  a vertical span is whole 0xFF bytes with a masked byte at each end, a rect is a vertical span's masks applied across
+  a run of columns. They all clip to the screen and take inclusive coordinates like MarkDirtyPixels.
+  The Span* versions don't touch the dirty tracking, the public ones mark their whole box once
+ */
+
+ // the bits for rows y0..y1 of a page, both already on the same page
+ static inline uint8_t RowMask(int y0, int y1) {
+     return (uint8_t)((0xFF << (y0 & 7)) & (0xFF >> (7 - (y1 & 7))));
+ }
+
+ static inline void ApplyMask(uint8_t *byte, uint8_t mask, bool on) {
+     if (on) *byte |= mask;
+     else *byte &= ~mask;
+ }
+
+ static inline void Order(int *a, int *b) {
+     if (*a > *b) { int t = *a; *a = *b; *b = t; }
+ }
+
+ static void SpanH(uint8_t *buf, int x0, int x1, int y, bool on) {
+     Order(&x0, &x1);
+     if (y < 0 || y >= SSD1306_HEIGHT || x1 < 0 || x0 >= SSD1306_WIDTH) return;
+     if (x0 < 0) x0 = 0;
+     if (x1 >= SSD1306_WIDTH) x1 = SSD1306_WIDTH - 1;
+
+     uint8_t *byte = &buf[(y >> 3) * SSD1306_WIDTH + x0];
+     uint8_t bit = 1 << (y & 7);
+
+     if (on) for (int x = x0; x <= x1; x++) *byte++ |= bit;
+     else for (int x = x0; x <= x1; x++) *byte++ &= ~bit;
  }
 
+ // fills columns x0..x1 between rows y0 and y1, a vertical span is just this with one column
+ static void SpanRect(uint8_t *buf, int x0, int x1, int y0, int y1, bool on) {
+     Order(&x0, &x1);
+     Order(&y0, &y1);
+     if (x1 < 0 || x0 >= SSD1306_WIDTH || y1 < 0 || y0 >= SSD1306_HEIGHT) return;
+     if (x0 < 0) x0 = 0;
+     if (x1 >= SSD1306_WIDTH) x1 = SSD1306_WIDTH - 1;
+     if (y0 < 0) y0 = 0;
+     if (y1 >= SSD1306_HEIGHT) y1 = SSD1306_HEIGHT - 1;
+
+     for (int page = y0 >> 3; page <= y1 >> 3; page++) {
+         int top = page * 8 > y0 ? page * 8 : y0;
+         int bottom = page * 8 + 7 < y1 ? page * 8 + 7 : y1;
+         uint8_t mask = RowMask(top, bottom);
+         uint8_t *row = &buf[page * SSD1306_WIDTH];
+
+         if (mask == 0xFF) {
+             memset(&row[x0], on ? 0xFF : 0x00, x1 - x0 + 1);
+         } else {
+             for (int x = x0; x <= x1; x++) ApplyMask(&row[x], mask, on);
+         }
+     }
+ }
+
+ static void MarkSpanDirty(const uint8_t *buf, int x0, int x1, int y0, int y1) {
+     if (buf != bufferGlobal) return;
+
+     Order(&x0, &x1);
+     Order(&y0, &y1);
+     MarkDirtyPixels(x0, x1, y0, y1);
+ }
+
+ /// @brief horizontal line from x0 to x1 on row y
+ void DrawHLine(uint8_t *buf, int x0, int x1, int y, bool on) {
+     SpanH(buf, x0, x1, y, on);
+     MarkSpanDirty(buf, x0, x1, y, y);
+ }
+
+ /// @brief vertical line from y0 to y1 in column x
+ void DrawVLine(uint8_t *buf, int x, int y0, int y1, bool on) {
+     SpanRect(buf, x, x, y0, y1, on);
+     MarkSpanDirty(buf, x, x, y0, y1);
+ }
+
+ /// @brief fills (or clears, with on false) a width x height box with its top left at x/y
+ void FillRect(uint8_t *buf, int x, int y, int width, int height, bool on) {
+     if (width <= 0 || height <= 0) return;
+
+     SpanRect(buf, x, x + width - 1, y, y + height - 1, on);
+     MarkSpanDirty(buf, x, x + width - 1, y, y + height - 1);
+ }
+
+ /// @brief just the outline of a width x height box
+ void DrawRect(uint8_t *buf, int x, int y, int width, int height, bool on) {
+     if (width <= 0 || height <= 0) return;
+
+     int x1 = x + width - 1, y1 = y + height - 1;
 
- // Basic Bresenhams.
+     SpanH(buf, x, x1, y, on);
+     SpanH(buf, x, x1, y1, on);
+     SpanRect(buf, x, x, y, y1, on);
+     SpanRect(buf, x1, x1, y, y1, on);
+     MarkSpanDirty(buf, x, x1, y, y1);
+ }
+
+ // Run-sliced Bresenham (the Abrash version). Instead of deciding every pixel, it works out how long each run along
+ // the major axis is (always wholeStep or wholeStep + 1) and draws the runs as spans, so a mostly flat line is a few
+ // horizontal spans and a mostly steep one is a few vertical ones
 void DrawLine(uint8_t *buf, int x0, int y0, int x1, int y1, bool on) {
- 
-     int dx =  abs(x1-x0);
-     int sx = x0<x1 ? 1 : -1;
-     int dy = -abs(y1-y0);
-     int sy = y0<y1 ? 1 : -1;
-     int err = dx+dy;
-     int e2;
- 
-     while (true) {
-         SetPixel(buf, x0, y0, on);
-         if (x0 == x1 && y0 == y1)
-             break;
-         e2 = 2*err;
- 
-         if (e2 >= dy) {
-             err += dy;
-             x0 += sx;
+
+     // always go down, so only x has a direction
+     if (y0 > y1) {
+         int t = x0; x0 = x1; x1 = t;
+         t = y0; y0 = y1; y1 = t;
+     }
+
+     int dx = abs(x1 - x0);
+     int dy = y1 - y0;
+     int xDir = x1 < x0 ? -1 : 1;
+
+     if (dy == 0 || dx == 0) {
+         SpanRect(buf, x0, x1, y0, y1, on);
+         MarkSpanDirty(buf, x0, x1, y0, y1);
+         return;
+     }
+
+     bool xMajor = dx >= dy;
+     int major = xMajor ? dx : dy;
+     int minor = xMajor ? dy : dx;
+
+     int wholeStep = major / minor;
+     int adjUp = (major % minor) * 2;
+     int adjDown = minor * 2;
+     int errorTerm = (major % minor) - minor * 2;
+
+     // the first and last runs split a whole step between them so the line is symmetric
+     int initialRun = wholeStep / 2 + 1;
+     int finalRun = initialRun;
+
+     if (adjUp == 0 && (wholeStep & 1) == 0) initialRun--;
+     if (wholeStep & 1) errorTerm += minor;
+
+     int x = x0, y = y0;
+
+     for (int i = 0; i <= minor; i++) {
+         int run;
+
+         if (i == 0) {
+             run = initialRun;
+         } else if (i == minor) {
+             run = finalRun;
+         } else {
+             run = wholeStep;
+             if ((errorTerm += adjUp) > 0) {
+                 run++;
+                 errorTerm -= adjDown;
+             }
          }
-         if (e2 <= dx) {
-             err += dx;
-             y0 += sy;
+
+         if (xMajor) {
+             SpanH(buf, x, x + xDir * (run - 1), y, on);
+             x += xDir * run;
+             y++;
+         } else {
+             SpanRect(buf, x, x, y, y + run - 1, on);
+             y += run;
+             x += xDir;
          }
      }
+
+     MarkSpanDirty(buf, x0, x1, y0, y1);
  }
 
  
- //if we keep adding letters, might want to refactor this
+ /*
+  Curves and polygons. The buffer is column bytes, so these all work a column at a time: work out which rows of
+  the column the shape covers and write them as one vertical span, which is a couple of masked bytes and some
+  whole ones. A filled circle ends up costing about the same as blitting a sprite the same size
+ */
+
+ // whether column d, row h (both from the centre) is outside an rx by ry ellipse, using the edge half a pixel out
+ // so a circle comes out the same as the midpoint one. Everything is doubled to stay in integers
+ static inline bool OutsideEllipse(int d, int h, int64_t a, int64_t b) {
+     return 4 * (int64_t)d * d * b + 4 * (int64_t)h * h * a > a * b;
+ }
+
+ static void EllipseSpans(uint8_t *buf, int cx, int cy, int rx, int ry, bool fill, bool on) {
+     if (rx < 0 || ry < 0) return;
+
+     int64_t a = (int64_t)(2 * rx + 1) * (2 * rx + 1);
+     int64_t b = (int64_t)(2 * ry + 1) * (2 * ry + 1);
+
+     // how far up and down the shape goes in the current column, it only ever shrinks heading out from the centre
+     int height = ry;
+
+     for (int d = 0; d <= rx; d++) {
+         int next = -1; // the height one column further out, -1 past the edge
+
+         if (d < rx) {
+             next = height;
+             while (next >= 0 && OutsideEllipse(d + 1, next, a, b)) next--;
+         }
+
+         for (int side = 0; side < (d ? 2 : 1); side++) {
+             int x = side ? cx - d : cx + d;
+
+             if (fill) {
+                 SpanRect(buf, x, x, cy - height, cy + height, on);
+             } else {
+                 // from this column's height down to just above where the next column starts, or at least one pixel
+                 int inner = next + 1 < height ? next + 1 : height;
+
+                 SpanRect(buf, x, x, cy - height, cy - inner, on);
+                 SpanRect(buf, x, x, cy + inner, cy + height, on);
+             }
+         }
+
+         height = next;
+     }
+
+     MarkSpanDirty(buf, cx - rx, cx + rx, cy - ry, cy + ry);
+ }
+
+ /// @brief outline of a circle centred on cx/cy
+ void DrawCircle(uint8_t *buf, int cx, int cy, int radius, bool on) {
+     EllipseSpans(buf, cx, cy, radius, radius, false, on);
+ }
+
+ void FillCircle(uint8_t *buf, int cx, int cy, int radius, bool on) {
+     EllipseSpans(buf, cx, cy, radius, radius, true, on);
+ }
 
+ /// @brief outline of an ellipse centred on cx/cy, radiusX across and radiusY up and down
+ void DrawEllipse(uint8_t *buf, int cx, int cy, int radiusX, int radiusY, bool on) {
+     EllipseSpans(buf, cx, cy, radiusX, radiusY, false, on);
+ }
+
+ void FillEllipse(uint8_t *buf, int cx, int cy, int radiusX, int radiusY, bool on) {
+     EllipseSpans(buf, cx, cy, radiusX, radiusY, true, on);
+ }
 
+ /// @brief outline of a polygon, points is x0, y0, x1, y1... and it gets closed back to the first point
+ void DrawPolygon(uint8_t *buf, const int *points, int count, bool on) {
+     for (int i = 0; i < count; i++) {
+         int j = (i + 1) % count;
+         DrawLine(buf, points[i * 2], points[i * 2 + 1], points[j * 2], points[j * 2 + 1], on);
+     }
+ }
 
- static inline int GetFontIndex(uint8_t ch) {
-    //I get it, it uses the int value of the character passed 
-    //but what is it returning?
+ /// @brief fills a convex polygon, points is x0, y0, x1, y1... Walks every edge once to find the top and bottom of
+ /// each column, then fills each column with one span. Concave ones come out filled in between their edges
+ void FillPolygon(uint8_t *buf, const int *points, int count, bool on) {
+     if (count < 1) return;
 
-    //the character, minus 'a' (65) + 1 (67
-    //its returning an int
-    //I get it, its outputting an actual number between 1-26 representing the actual number
-    //thats why it has the +1, to get around the blank letter at the start
-    //but the actual logic for finding the letter in the array in ssd1306_font is handled later
-    //so A is 65, if a C is passed in its 67 - 65 + 1 = 3
+     int top[SSD1306_WIDTH], bottom[SSD1306_WIDTH];
+     for (int x = 0; x < SSD1306_WIDTH; x++) {
+         top[x] = SSD1306_HEIGHT;
+         bottom[x] = -1;
+     }
 
-    if (ch >= 'A' && ch <='Z') {
-        return  ch - 'A' + 1;
+     int minX = points[0], maxX = points[0], minY = points[1], maxY = points[1];
+
+     for (int i = 0; i < count; i++) {
+         int j = (i + 1) % count;
+         int x0 = points[i * 2], y0 = points[i * 2 + 1];
+         int x1 = points[j * 2], y1 = points[j * 2 + 1];
+
+         if (x0 < minX) minX = x0;
+         if (x0 > maxX) maxX = x0;
+         if (y0 < minY) minY = y0;
+         if (y0 > maxY) maxY = y0;
+
+         // plain Bresenham, but only to find the edge's pixels, nothing gets drawn
+         int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+         int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+         int err = dx + dy;
+
+         while (true) {
+             if (x0 >= 0 && x0 < SSD1306_WIDTH) {
+                 if (y0 < top[x0]) top[x0] = y0;
+                 if (y0 > bottom[x0]) bottom[x0] = y0;
+             }
+             if (x0 == x1 && y0 == y1) break;
+
+             int e2 = 2 * err;
+             if (e2 >= dy) { err += dy; x0 += sx; }
+             if (e2 <= dx) { err += dx; y0 += sy; }
+         }
      }
 
-     //but this one just removes 0, which is actually 48. 
-     //so if 4 is added its 52 - 48 + 27 = 31
-     //these seem to be skipping the empty space at the start actaully
-     else if (ch >= '0' && ch <='9') {
-        return  ch - '0' + 27;
-     }else if(ch == '-'){
-        return  37;
-     }else if(ch == '/'){
-        return  38;
-     }else if(ch == '/'){
-        return  39;
-     }else if(ch == '!'){
-        return  38;
-     }else if(ch == '?'){
-        return  38;
+     for (int x = minX < 0 ? 0 : minX; x <= maxX && x < SSD1306_WIDTH; x++) {
+         if (top[x] <= bottom[x]) SpanRect(buf, x, x, top[x], bottom[x], on);
      }
 
-     else return  0; // Not got that char so space.
+     MarkSpanDirty(buf, minX, maxX, minY, maxY);
  }
+
  
+ /*
+  Text. Glyphs get drawn straight into whatever buffer at any x/y. Each glyph column gets shifted down to y and
+  split over the pages it lands on, the same byte shift the sprite blitter does, so text doesn't have to sit on a
+  page boundary. The whole cell height is replaced, text is opaque like it always has been, and invert draws it
+  light on dark. Anything outside the buffer gets clipped
+ */
 
+ // anything the font doesn't have comes out as its first glyph, the space in all the built in ones
+ static inline int FontGlyph(const struct ssd1306_font *font, uint8_t ch) {
+     int glyph = font->map ? (ch < 128 ? font->map[ch] : 0) : ch - font->first;
+     return (glyph >= 0 && glyph < font->count) ? glyph : 0;
+ }
 
-static void WriteCharReworked(uint8_t *buf,  int16_t x, int16_t y, uint8_t ch, int* counter, bool invert) {
-     if (x > SSD1306_WIDTH - 8 || y > SSD1306_HEIGHT - 8)
-         return;
+ static inline int GlyphAdvance(const struct ssd1306_font *font, int glyph) {
+     return (font->advance ? font->advance[glyph] : font->width) + font->spacing;
+ }
 
-     // For the moment, only write on Y row boundaries (every 8 vertical pixels)
+ // one column of a glyph, all its pages in one word (fonts up to 32 high)
+ static inline uint32_t GlyphColumn(const struct ssd1306_font *font, int glyph, int col) {
+     if (col >= font->width) return 0;
 
-     ch = toupper(ch);
-     int idx = GetFontIndex(ch);
+     int pages = (font->height + 7) / 8;
+     const uint8_t *g = &font->glyphs[glyph * font->width * pages + col];
+     uint32_t bits = 0;
 
-     for (int i=0;i<8;i++) {
+     for (int p = 0; p < pages; p++) bits |= (uint32_t)g[p * font->width] << (p * 8);
 
-        uint8_t letter = font[idx * 8 + i];
-        if(invert){
-            letter = 255 - letter;
-        }
-        buf[*counter] = letter;
+     return bits;
+ }
 
-        *counter = *counter + 1;
-    }
+ // replaces `height` rows of column x starting at y with bits, shifted down and split over the pages they land on
+ static void PutTextColumn(uint8_t *buf, int bufWidth, int bufHeight, int x, int y, uint32_t bits, int height) {
+     if (x < 0 || x >= bufWidth) return;
+
+     int pages = (bufHeight + 7) / 8;
+     uint64_t mask = ((1ull << height) - 1) << (y & 7);
+     uint64_t data = ((uint64_t)bits << (y & 7)) & mask;
+
+     for (int page = y >> 3; mask && page < pages; page++, mask >>= 8, data >>= 8) {
+         if (page < 0) continue;
+
+         uint8_t m = (uint8_t)mask;
+         if (page == pages - 1 && (bufHeight & 7)) m &= (1 << (bufHeight & 7)) - 1;
+
+         uint8_t *dst = &buf[page * bufWidth + x];
+         *dst = (*dst & ~m) | ((uint8_t)data & m);
+     }
  }
 
-void WriteStringBlock(uint8_t *buf,  int16_t x, int16_t y, const char *str, int longest, int* counter, bool invert) {
-     // Cull out any string off the screen
-    if (x > SSD1306_WIDTH - 8 || y > SSD1306_HEIGHT - 8)
-        return;
+ /// @brief how many pixels wide str comes out in font (NULL for the 8x8)
+ int MeasureText(const struct ssd1306_font *font, const char *str) {
+     if (!font) font = &ssd1306_font_8x8;
 
- 
-    for(int i=0;i<longest;i++) {
-        //the string should never, ever be longer than the longest variable
-        //nevertheless, some safety would be good
+     int width = 0;
+     for (; *str; str++) width += GlyphAdvance(font, FontGlyph(font, (uint8_t)*str));
+
+     return width;
+ }
+
+ /// @brief draws str into a bufWidth x bufHeight page format buffer (a sprite's img, say) with its top left at x/y
+ /// @return the x just past the end of the text
+ int DrawTextTo(uint8_t *buf, int bufWidth, int bufHeight, const struct ssd1306_font *font, int x, int y, const char *str, bool invert) {
+     if (!font) font = &ssd1306_font_8x8;
+     if (y >= bufHeight || y + font->height <= 0) return x + MeasureText(font, str);
+
+     for (; *str; str++) {
+         int glyph = FontGlyph(font, (uint8_t)*str);
+         int advance = GlyphAdvance(font, glyph);
+
+         if (x >= bufWidth) {
+             x += advance;
+             continue;
+         }
+
+         if (x + advance > 0) {
+             int left = font->left ? font->left[glyph] : 0;
+
+             for (int c = 0; c < advance; c++) {
+                 // past the glyph's own columns is the spacing, which is blank
+                 uint32_t bits = (c < advance - font->spacing) ? GlyphColumn(font, glyph, left + c) : 0;
+                 PutTextColumn(buf, bufWidth, bufHeight, x + c, y, invert ? ~bits : bits, font->height);
+             }
+         }
+
+         x += advance;
+     }
 
-        //if i>=strlen(str), send in a space, otherwise send in the letter
-        WriteCharReworked(buf, x, y, (i>=strlen(str)) ? ' ' : str[i], counter, invert);
+     return x;
+ }
+
+ /// @brief draws str into a screen sized buffer at x/y, anything hanging off the edges gets clipped
+ /// @return the x just past the end of the text
+ int DrawText(uint8_t *buf, const struct ssd1306_font *font, int x, int y, const char *str, bool invert) {
+     if (!font) font = &ssd1306_font_8x8;
+
+     int end = DrawTextTo(buf, SSD1306_WIDTH, SSD1306_HEIGHT, font, x, y, str, invert);
+
+     if (buf == bufferGlobal) MarkDirtyPixels(x, end - 1, y, y + font->height - 1);
+
+     return end;
+ }
 
-        x+=8;
+/// @brief draws str padded out with spaces to `longest` characters (cut off past that), so a highlighted line goes
+/// all the way across. With a counter buf is a strip `longest` characters wide, the line goes in at byte *counter
+/// and counter moves on past it, like it always did. Without one buf is screen sized and the line goes at x/y
+void WriteStringBlock(uint8_t *buf,  int16_t x, int16_t y, const char *str, int longest, int* counter, bool invert) {
+    int width = SSD1306_WIDTH;
+    int height = SSD1306_HEIGHT;
+    int right = x + longest * 8;
+
+    if (counter) {
+        buf += *counter;
+        *counter += longest * 8;
+
+        width = right = longest * 8;
+        height = 8;
+        x = y = 0;
     }
+
+    if (right < width) width = right;
+
+    int len = strlen(str);
+    int end = DrawTextTo(buf, width, height, NULL, x, y, str, invert);
+
+    for (int i = len; i < longest; i++) end = DrawTextTo(buf, width, height, NULL, end, y, " ", invert);
+
+    if (buf == bufferGlobal) MarkDirtyPixels(x, (end < width ? end : width) - 1, y, y + 7);
  }
  
  /// @brief loops through an array of strings (*char) and returns the length of the longest (not what the longest is)
@@ -445,25 +1462,12 @@ int GetLongestString(const char **text, int length){
     return longest;
 }
  
- 
+ /// @brief draws str into a screen sized buffer at x/y in the 8x8 font
 void WriteString(uint8_t *buf,  int16_t x, int16_t y, const char *str, bool invert) {
-     // Cull out any string off the screen
-     if (x > SSD1306_WIDTH - 8 || y > SSD1306_HEIGHT - 8)
-         return;
-
-     int counterForThingy = 0;
-
-    for(int i=0;i<strlen(str);i++) {
-        //the string should never, ever be longer than the longest variable
-        //nevertheless, some safety would be good
-
-        //if i>=strlen(str), send in a space, otherwise send in the letter
-        WriteCharReworked(buf, x, y,str[i], &counterForThingy, invert);
-    }
+    DrawText(buf, NULL, x, y, str, invert);
  }
 
 
- #endif
 
   //We need to figre out two things in these functions:
 
@@ -589,37 +1593,17 @@ void DisplayItemFoundText(int posX, int posY, char * letters){
 
 
 
+/// @brief clears a block of pages in the global buffer, it goes out with the next update like DeleteScreen
 void DeleteWindow(int startCol, int endCol, int startPage, int endPage){
-    struct render_area frame_area = {
-        start_col: startCol,
-        end_col : endCol ,
-        start_page : startPage,
-        end_page : endPage
-        };
-
-
-    calc_render_area_buflen(&frame_area);
-
-    // zero the entire display
-
-    uint8_t buf[frame_area.buflen];
-    memset(buf, 0, frame_area.buflen);
-
-    //colors everything in
-    for (int x = 0;x < SSD1306_WIDTH-1;x++) {
-        for (int y = SSD1306_HEIGHT-1; y >= 0 ;y--) {
-            SetPixel(buf,x,y,false);
-        }
-    }
-    render(buf, &frame_area,  false);
+    FillRect(bufferGlobal, startCol, startPage * 8, endCol - startCol + 1, (endPage - startPage + 1) * 8, false);
 }
 
 
 void DeleteScreen(){
 
-    for(int i = 0; i < count_of(bufferGlobal);i++){
-        bufferGlobal[i] = (uint8_t)0;
-    }
+    memset(bufferGlobal, 0, SSD1306_BUF_LEN);
+
+    MarkAllDirty();
 
     //UpdateFromGlobal();
 }
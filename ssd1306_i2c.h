@@ -9,23 +9,64 @@
 #include "pico/binary_info.h"
 #include "hardware/i2c.h"
 #include "ssd1306_font.h"
+#include "ssd1306_transport.h"
 
 
 //For future reference, you have to do this because apparently the name gets mangled if you dont cast it to C
 
 
-extern uint8_t bufferGlobal[1024];
+//back buffer, everything draws into this. UpdateFromGlobal flips it to the front
+extern uint8_t *bufferGlobal;
 
 extern "C" void DrawLine(uint8_t *buf, int x0, int y0, int x1, int y1, bool on);
+extern "C" void DrawHLine(uint8_t *buf, int x0, int x1, int y, bool on);
+extern "C" void DrawVLine(uint8_t *buf, int x, int y0, int y1, bool on);
+extern "C" void FillRect(uint8_t *buf, int x, int y, int width, int height, bool on);
+extern "C" void DrawRect(uint8_t *buf, int x, int y, int width, int height, bool on);
+extern "C" void DrawCircle(uint8_t *buf, int cx, int cy, int radius, bool on);
+extern "C" void FillCircle(uint8_t *buf, int cx, int cy, int radius, bool on);
+extern "C" void DrawEllipse(uint8_t *buf, int cx, int cy, int radiusX, int radiusY, bool on);
+extern "C" void FillEllipse(uint8_t *buf, int cx, int cy, int radiusX, int radiusY, bool on);
+extern "C" void DrawPolygon(uint8_t *buf, const int *points, int count, bool on);
+extern "C" void FillPolygon(uint8_t *buf, const int *points, int count, bool on);
 extern "C" void DisplayImage(int posX, int posY, int width, int height, const uint8_t *hex); // one way
 extern "C" void InitializeScreen(); // one way
 extern "C" void DeleteScreen();
 extern "C" void DeleteWindow(int startCol, int endCol, int startPage, int endPage);
 extern "C" void UpdateFromGlobal();
+extern "C" void SwapBuffers();
+extern "C" void SetFullRedraw(bool on);
+extern "C" const uint8_t *GetFrontBuffer();
+extern "C" uint32_t UpdateFromGlobalAsync(void (*onComplete)(void));
+extern "C" bool FlushFenceReached(uint32_t fence);
+extern "C" bool FlushWait(uint32_t fence);
+extern "C" bool FlushFailed(uint32_t fence);
+extern "C" uint32_t GetFlushFailures();
+extern "C" bool FlushBusy();
+extern "C" void StartDisplayCore();
+extern "C" bool DisplayCoreRunning();
+extern "C" void UpdateFromGlobalPipelined();
+extern "C" void PipelineFrameStart();
+extern "C" void ResetPipelineStats();
+extern "C" float GetCoreUtilization(int core);
+extern "C" float GetPipelineFps();
 extern "C" void calc_render_area_buflen(struct render_area *area);
 extern "C" void WriteString(uint8_t *buf,  int16_t x, int16_t y, const char *str,  bool invert);
+extern "C" int DrawText(uint8_t *buf, const struct ssd1306_font *font, int x, int y, const char *str, bool invert);
+extern "C" int DrawTextTo(uint8_t *buf, int bufWidth, int bufHeight, const struct ssd1306_font *font, int x, int y, const char *str, bool invert);
+extern "C" int MeasureText(const struct ssd1306_font *font, const char *str);
 extern "C" int GetLongestString(const char **text, int length);
 extern "C" void WriteStringBlock(uint8_t *buf,  int16_t x, int16_t y, const char *str, int longest, int* counter, bool invert);
 extern "C" void SetPixel(uint8_t *buf, int x,int y, bool on);
+extern "C" void MarkDirty(int startCol, int endCol, int startPage, int endPage);
+extern "C" void MarkDirtyPixels(int xStart, int xEnd, int yStart, int yEnd);
+extern "C" void MarkAllDirty();
+extern "C" int GetLastFlushBytes();
+extern "C" int GetLastFlushWindows();
+extern "C" void InvalidateShadow();
+extern "C" uint32_t GetBusTransactions();
+extern "C" uint32_t GetBusWireBytes();
+extern "C" uint32_t GetBusWireBytesSaved();
+extern "C" void ResetBusStats();
 
 #endif
\ No newline at end of file
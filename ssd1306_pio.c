@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "ssd1306_transport.h"
+#include "ssd1306_bus.pio.h"
+
+/*
+ PIO transport. Same transactions as the hardware i2c one, but clocked out by the ssd1306_bus PIO program so the
+ clock isn't capped by the i2c block. Each byte becomes a 32 bit FIFO word (see ssd1306_bus.pio for the layout),
+ words get built a chunk at a time and fed to the state machine by DMA, the next chunk gets built while the last
+ one is going out.
+*/
+
+#define SSD1306_PIO_START_BIT   (1u << 31)
+#define SSD1306_PIO_STOP_BIT    (1u << 30)
+#define SSD1306_PIO_DATA_SHIFT  22
+
+#define SSD1306_PIO_CHUNK_WORDS 128
+
+struct ssd1306_pio_bus {
+    PIO pio;
+    uint sm;
+    int dmaChannel;
+    dma_channel_config dmaConfig;
+    uint8_t address;
+};
+
+static struct ssd1306_pio_bus pioBus;
+static uint32_t chunkWords[2][SSD1306_PIO_CHUNK_WORDS];
+
+static inline uint32_t EncodeByte(uint8_t byte, uint32_t flags) {
+    return flags | ((uint32_t)(uint8_t)~byte << SSD1306_PIO_DATA_SHIFT);
+}
+
+// waits for the state machine to run out of words and stall on its pull, which it only does once the last
+// byte (and the STOP) is completely out
+static void WaitIdle(struct ssd1306_pio_bus *bus) {
+    uint32_t stall = 1u << (PIO_FDEBUG_TXSTALL_LSB + bus->sm);
+
+    bus->pio->fdebug = stall;
+    while (!(bus->pio->fdebug & stall))
+        tight_loop_contents();
+}
+
+static void SSD1306_pio_write(void *ctx, const uint8_t *head, int headLen, const uint8_t *buf, int width, int rows, int stride) {
+    struct ssd1306_pio_bus *bus = (struct ssd1306_pio_bus *)ctx;
+
+    // the address byte goes first, so that's index -headLen - 1
+    int last = width * rows - 1;
+    int which = 0;
+
+    for (int i = -headLen - 1; i <= last;) {
+        int count = 0;
+
+        for (; count < SSD1306_PIO_CHUNK_WORDS && i <= last; count++, i++) {
+            uint8_t byte;
+            uint32_t flags = 0;
+
+            if (i == -headLen - 1) {
+                byte = bus->address << 1; // write
+                flags |= SSD1306_PIO_START_BIT;
+            } else if (i < 0) {
+                byte = head[headLen + i];
+            } else {
+                byte = buf[(i / width) * stride + (i % width)];
+            }
+
+            if (i == last) flags |= SSD1306_PIO_STOP_BIT;
+
+            chunkWords[which][count] = EncodeByte(byte, flags);
+        }
+
+        dma_channel_wait_for_finish_blocking(bus->dmaChannel);
+        dma_channel_configure(bus->dmaChannel, &bus->dmaConfig, &bus->pio->txf[bus->sm], chunkWords[which], count, true);
+
+        which ^= 1;
+    }
+
+    dma_channel_wait_for_finish_blocking(bus->dmaChannel);
+    WaitIdle(bus);
+}
+
+const struct ssd1306_transport ssd1306_pio_transport = { SSD1306_pio_write, &pioBus };
+
+/// @brief Loads the bus program onto a PIO block, takes over the two pins and makes it the transport. Do this after
+/// InitializeScreen if you want to keep the same pins, the init commands will already have gone out over i2c.
+/// Panels have been fine well past 1000 kHz, but it depends on the pullups and wiring
+/// @param pioIndex which PIO block, 0 or 1 (2 as well on the RP2350)
+/// @param address usually 0x3C
+/// @return false if there's no room for the program or no free state machine, the transport doesn't change
+bool SSD1306_use_pio_bus(unsigned pioIndex, unsigned sdaPin, unsigned sclPin, unsigned khz, uint8_t address) {
+    PIO pio = pio_get_instance(pioIndex);
+
+    if (!pio_can_add_program(pio, &ssd1306_bus_program)) return false;
+
+    int sm = pio_claim_unused_sm(pio, false);
+    if (sm < 0) return false;
+
+    uint offset = pio_add_program(pio, &ssd1306_bus_program);
+    ssd1306_bus_program_init(pio, sm, offset, sdaPin, sclPin, khz);
+
+    pioBus.pio = pio;
+    pioBus.sm = sm;
+    pioBus.address = address;
+    pioBus.dmaChannel = dma_claim_unused_channel(true);
+
+    dma_channel_config config = dma_channel_get_default_config(pioBus.dmaChannel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, pio_get_dreq(pio, sm, true));
+    pioBus.dmaConfig = config;
+
+    SSD1306_set_transport(&ssd1306_pio_transport);
+
+    return true;
+}
@@ -0,0 +1,205 @@
+#include <string.h>
+#include "ssd1306_sim.h"
+
+// how many argument bytes follow each command
+static int ArgCount(uint8_t cmd) {
+    switch (cmd) {
+        case 0x20: // memory mode
+        case 0x81: // contrast
+        case 0x8D: // charge pump
+        case 0xA8: // mux ratio
+        case 0xD3: // display offset
+        case 0xD5: // clock divide
+        case 0xD9: // precharge
+        case 0xDA: // com pins
+        case 0xDB: // vcom deselect
+            return 1;
+        case 0x21: // column address
+        case 0x22: // page address
+        case 0xA3: // vertical scroll area
+            return 2;
+        case 0x29: // vertical and horizontal scroll
+        case 0x2A:
+            return 5;
+        case 0x26: // horizontal scroll
+        case 0x27:
+            return 6;
+        default:
+            return 0;
+    }
+}
+
+static void RunCommand(struct ssd1306_sim *sim) {
+    uint8_t cmd = sim->cmd;
+    uint8_t *args = sim->args;
+
+    if (cmd <= 0x0F) { // page mode lower column nibble
+        sim->col = (sim->col & 0xF0) | cmd;
+    } else if (cmd <= 0x1F) { // page mode higher column nibble
+        sim->col = ((cmd & 0x0F) << 4) | (sim->col & 0x0F);
+    } else if (cmd >= 0x40 && cmd <= 0x7F) {
+        sim->startLine = cmd & 0x3F;
+    } else if (cmd >= 0xB0 && cmd <= 0xB7) {
+        sim->page = cmd & 0x07;
+    } else {
+        switch (cmd) {
+            case 0x20: sim->memMode = args[0] & 0x03; break;
+            case 0x21:
+                sim->colStart = args[0] & 0x7F;
+                sim->colEnd = args[1] & 0x7F;
+                sim->col = sim->colStart;
+                break;
+            case 0x22:
+                sim->pageStart = args[0] & 0x07;
+                sim->pageEnd = args[1] & 0x07;
+                sim->page = sim->pageStart;
+                break;
+            case 0x26: case 0x27: case 0x29: case 0x2A:
+                sim->scrollCmd = cmd;
+                memcpy(sim->scrollArgs, args, ArgCount(cmd));
+                break;
+            case 0x2E: sim->scrolling = false; break;
+            case 0x2F: sim->scrolling = true; break;
+            case 0x81: sim->contrast = args[0]; break;
+            case 0xA0: case 0xA1: sim->segRemap = cmd & 0x01; break;
+            case 0xA4: case 0xA5: sim->entireOn = cmd & 0x01; break;
+            case 0xA6: case 0xA7: sim->inverted = cmd & 0x01; break;
+            case 0xAE: case 0xAF: sim->displayOn = cmd & 0x01; break;
+            case 0xC0: case 0xC8: sim->comFlip = (cmd == 0xC8); break;
+            case 0xD3: sim->displayOffset = args[0] & 0x3F; break;
+            default: break; // timing, charge pump etc. don't change what's in RAM
+        }
+    }
+}
+
+static void CommandByte(struct ssd1306_sim *sim, uint8_t byte) {
+    sim->commandBytes++;
+
+    if (sim->argsNeed > sim->argsHave) {
+        sim->args[sim->argsHave++] = byte;
+    } else {
+        sim->cmd = byte;
+        sim->argsHave = 0;
+        sim->argsNeed = ArgCount(byte);
+    }
+
+    if (sim->argsHave == sim->argsNeed) {
+        RunCommand(sim);
+        sim->argsNeed = 0;
+        sim->argsHave = 0;
+    }
+}
+
+static void DataByte(struct ssd1306_sim *sim, uint8_t byte) {
+    sim->dataBytes++;
+    if (sim->scrolling) sim->writesWhileScrolling++;
+
+    sim->gddram[sim->page & 0x07][sim->col & 0x7F] = byte;
+
+    // the pointers move on differently depending on the addressing mode (datasheet 10.1.3)
+    if (sim->memMode == 0) {
+        if (sim->col++ >= sim->colEnd) {
+            sim->col = sim->colStart;
+            if (sim->page++ >= sim->pageEnd) sim->page = sim->pageStart;
+        }
+    } else if (sim->memMode == 1) {
+        if (sim->page++ >= sim->pageEnd) {
+            sim->page = sim->pageStart;
+            if (sim->col++ >= sim->colEnd) sim->col = sim->colStart;
+        }
+    } else {
+        sim->col = (sim->col + 1) & 0x7F;
+    }
+}
+
+static void SimWrite(void *ctx, const uint8_t *head, int headLen, const uint8_t *buf, int width, int rows, int stride) {
+    struct ssd1306_sim *sim = (struct ssd1306_sim *)ctx;
+
+    sim->transactions++;
+    sim->wireBytes += 1 + headLen + width * rows;
+
+    // every transaction starts on a control byte. Co = 1 means one byte then another control byte,
+    // Co = 0 means the rest of the transaction is all commands or all data depending on D/C
+    bool expectControl = true;
+    bool continuation = false;
+    bool isData = false;
+
+    for (int i = -headLen; i < width * rows; i++) {
+        uint8_t byte = (i < 0) ? head[headLen + i] : buf[(i / width) * stride + (i % width)];
+
+        if (expectControl) {
+            continuation = byte & 0x80;
+            isData = byte & 0x40;
+            expectControl = false;
+            continue;
+        }
+
+        if (isData) DataByte(sim, byte);
+        else CommandByte(sim, byte);
+
+        if (continuation) expectControl = true;
+    }
+}
+
+/// @brief sets the sim up the way the chip comes out of reset
+void ssd1306_sim_init(struct ssd1306_sim *sim, int clockKHz) {
+    memset(sim, 0, sizeof(*sim));
+
+    sim->memMode = 2; // page addressing is the reset default
+    sim->colEnd = SSD1306_SIM_WIDTH - 1;
+    sim->pageEnd = SSD1306_SIM_PAGES - 1;
+    sim->contrast = 0x7F;
+    sim->clockKHz = clockKHz;
+}
+
+struct ssd1306_transport ssd1306_sim_transport(struct ssd1306_sim *sim) {
+    struct ssd1306_transport transport = { SimWrite, sim };
+    return transport;
+}
+
+void ssd1306_sim_reset_stats(struct ssd1306_sim *sim) {
+    sim->transactions = 0;
+    sim->wireBytes = 0;
+    sim->commandBytes = 0;
+    sim->dataBytes = 0;
+    sim->writesWhileScrolling = 0;
+}
+
+/// @brief how long everything since the last reset would have taken on a real bus. Each byte is 9 clocks
+/// (8 bits and the ACK), each transaction adds about one clock each for the start and the stop
+uint32_t ssd1306_sim_wire_time_us(const struct ssd1306_sim *sim) {
+    uint64_t clocks = (uint64_t)sim->wireBytes * 9 + (uint64_t)sim->transactions * 2;
+    return (uint32_t)(clocks * 1000 / sim->clockKHz);
+}
+
+/// @brief what's in the sims RAM at x/y, ignoring start line, offset and scrolling
+bool ssd1306_sim_get_pixel(const struct ssd1306_sim *sim, int x, int y) {
+    if (x < 0 || x >= SSD1306_SIM_WIDTH || y < 0 || y >= SSD1306_SIM_PAGES * 8) return false;
+
+    return (sim->gddram[y / 8][x] >> (y % 8)) & 1;
+}
+
+/// @brief what the panel would actually be showing at x/y, taking in the start line, display offset, inversion
+/// and the display being off. Scrolling isn't animated so that's not in here
+bool ssd1306_sim_visible_pixel(const struct ssd1306_sim *sim, int x, int y) {
+    if (!sim->displayOn) return false;
+    if (sim->entireOn) return true;
+
+    int row = (y + sim->startLine + sim->displayOffset) % (SSD1306_SIM_PAGES * 8);
+
+    return ssd1306_sim_get_pixel(sim, x, row) != sim->inverted;
+}
+
+/// @brief dumps the visible image as text, one character per pixel
+void ssd1306_sim_print(const struct ssd1306_sim *sim, FILE *out, int height) {
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < SSD1306_SIM_WIDTH; x++) {
+            fputc(ssd1306_sim_visible_pixel(sim, x, y) ? '#' : '.', out);
+        }
+        fputc('\n', out);
+    }
+
+    fprintf(out, "%u transactions, %u bytes (%u command, %u data), %u us at %d kHz\n",
+            sim->transactions, sim->wireBytes, sim->commandBytes, sim->dataBytes,
+            ssd1306_sim_wire_time_us(sim), sim->clockKHz);
+}
@@ -0,0 +1,82 @@
+#ifndef SSD1306SIMH
+#define SSD1306SIMH
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ssd1306_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ A pretend SSD1306 that sits behind the transport interface. It reads the same control/command/data stream the
+ real thing would and keeps its own GDDRAM, so render paths can be run and checked without a panel (or a Pico,
+ it doesn't use anything from the SDK). It also counts what went over the bus and works out how long that would
+ have taken at a given i2c clock.
+
+ Usage:
+    struct ssd1306_sim sim;
+    ssd1306_sim_init(&sim, 400);
+    struct ssd1306_transport t = ssd1306_sim_transport(&sim);
+    SSD1306_set_transport(&t);
+*/
+
+#define SSD1306_SIM_WIDTH   128
+#define SSD1306_SIM_PAGES   8
+
+struct ssd1306_sim {
+    uint8_t gddram[SSD1306_SIM_PAGES][SSD1306_SIM_WIDTH];
+
+    /* addressing */
+    uint8_t memMode;        // 0 horizontal, 1 vertical, 2 page
+    uint8_t colStart, colEnd;
+    uint8_t pageStart, pageEnd;
+    uint8_t col, page;      // where the next data byte lands
+
+    /* display state */
+    uint8_t startLine;
+    uint8_t displayOffset;
+    uint8_t contrast;
+    bool displayOn;
+    bool inverted;
+    bool entireOn;
+    bool segRemap;
+    bool comFlip;
+
+    /* scrolling, only recorded, the sim doesn't animate it */
+    bool scrolling;
+    uint8_t scrollCmd;      // 0x26/0x27 horizontal, 0x29/0x2A vertical and horizontal
+    uint8_t scrollArgs[6];
+
+    /* command parser, commands and their arguments can be split over control bytes and transactions */
+    uint8_t cmd;
+    uint8_t args[6];
+    int argsHave;
+    int argsNeed;
+
+    /* bus stats */
+    int clockKHz;
+    uint32_t transactions;
+    uint32_t wireBytes;         // address byte included
+    uint32_t commandBytes;
+    uint32_t dataBytes;
+    uint32_t writesWhileScrolling; // the datasheet says RAM gets corrupted if you do this
+};
+
+void ssd1306_sim_init(struct ssd1306_sim *sim, int clockKHz);
+struct ssd1306_transport ssd1306_sim_transport(struct ssd1306_sim *sim);
+
+void ssd1306_sim_reset_stats(struct ssd1306_sim *sim);
+uint32_t ssd1306_sim_wire_time_us(const struct ssd1306_sim *sim);
+
+bool ssd1306_sim_get_pixel(const struct ssd1306_sim *sim, int x, int y);
+bool ssd1306_sim_visible_pixel(const struct ssd1306_sim *sim, int x, int y);
+void ssd1306_sim_print(const struct ssd1306_sim *sim, FILE *out, int height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,118 @@
+#include <string.h>
+#include "ssd1306_transform.h"
+
+#define ROWS_OF_BYTE 0x0101010101010101ull
+
+/// @brief transposes an 8x8 bit matrix held as 8 bytes, bit j of byte i swaps with bit i of byte j. For a page
+/// format block that's columns becoming rows. Three rounds of swapping 1x1, 2x2 then 4x4 blocks (Hacker's Delight 7-3)
+uint64_t Transpose8x8(uint64_t x) {
+    uint64_t t;
+
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+    x = x ^ t ^ (t << 28);
+
+    return x;
+}
+
+// the rows of a page that are actually part of the image
+static inline uint8_t PageRows(int page, int height) {
+    int rows = height - page * 8;
+    return rows >= 8 ? 0xFF : (uint8_t)((1 << rows) - 1);
+}
+
+// the 8x8 block at page/column block, anything past the edges is 0
+static uint64_t GatherTile(const uint8_t *img, int width, int height, int page, int block) {
+    uint64_t tile = 0;
+    int cols = width - block * 8 < 8 ? width - block * 8 : 8;
+
+    for (int i = 0; i < cols; i++) tile |= (uint64_t)img[page * width + block * 8 + i] << (i * 8);
+
+    return tile & (PageRows(page, height) * ROWS_OF_BYTE);
+}
+
+static void ScatterTile(uint8_t *img, int width, int page, int block, uint64_t tile) {
+    int cols = width - block * 8 < 8 ? width - block * 8 : 8;
+
+    for (int i = 0; i < cols; i++) img[page * width + block * 8 + i] = (uint8_t)(tile >> (i * 8));
+}
+
+/// @brief swaps x and y, dst comes out height wide and width high
+void TransposeBitmap(const uint8_t *src, uint8_t *dst, int width, int height) {
+    int pages = (height + 7) / 8, blocks = (width + 7) / 8;
+
+    if (src == dst) {
+        // only square ones get here, so block (p, b) and (b, p) just trade places
+        uint8_t *img = dst;
+
+        for (int p = 0; p < pages; p++) {
+            for (int b = p; b < blocks; b++) {
+                uint64_t a = Transpose8x8(GatherTile(img, width, height, p, b));
+                uint64_t c = Transpose8x8(GatherTile(img, width, height, b, p));
+
+                ScatterTile(img, height, b, p, a);
+                if (b != p) ScatterTile(img, height, p, b, c);
+            }
+        }
+        return;
+    }
+
+    for (int p = 0; p < pages; p++) {
+        for (int b = 0; b < blocks; b++) {
+            ScatterTile(dst, height, b, p, Transpose8x8(GatherTile(src, width, height, p, b)));
+        }
+    }
+}
+
+/// @brief reverses each page's columns, in place
+void MirrorBitmapX(uint8_t *img, int width, int height) {
+    for (int p = 0; p < (height + 7) / 8; p++) {
+        uint8_t *row = &img[p * width];
+
+        uint8_t rows = PageRows(p, height);
+
+        for (int a = 0, b = width - 1; a <= b; a++, b--) {
+            uint8_t t = row[a];
+            row[a] = row[b] & rows;
+            row[b] = t & rows;
+        }
+    }
+}
+
+/// @brief turns it upside down, in place. Each column is at most 64 rows so a whole column fits in one word,
+/// reverse it and shift it back down to the height
+void MirrorBitmapY(uint8_t *img, int width, int height) {
+    int pages = (height + 7) / 8;
+    if (height <= 0) return;
+
+    for (int x = 0; x < width; x++) {
+        uint64_t col = 0;
+
+        for (int p = 0; p < pages; p++) col |= (uint64_t)(img[p * width + x] & PageRows(p, height)) << (p * 8);
+
+        col = ((col >> 1) & 0x5555555555555555ull) | ((col & 0x5555555555555555ull) << 1);
+        col = ((col >> 2) & 0x3333333333333333ull) | ((col & 0x3333333333333333ull) << 2);
+        col = ((col >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((col & 0x0F0F0F0F0F0F0F0Full) << 4);
+        col = __builtin_bswap64(col) >> (64 - height);
+
+        for (int p = 0; p < pages; p++) img[p * width + x] = (uint8_t)(col >> (p * 8));
+    }
+}
+
+void RotateBitmap90(const uint8_t *src, uint8_t *dst, int width, int height) {
+    TransposeBitmap(src, dst, width, height);
+    MirrorBitmapX(dst, height, width);
+}
+
+void RotateBitmap270(const uint8_t *src, uint8_t *dst, int width, int height) {
+    TransposeBitmap(src, dst, width, height);
+    MirrorBitmapY(dst, height, width);
+}
+
+void RotateBitmap180(uint8_t *img, int width, int height) {
+    MirrorBitmapX(img, width, height);
+    MirrorBitmapY(img, width, height);
+}
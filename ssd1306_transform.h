@@ -0,0 +1,31 @@
+#ifndef SSD1306TRANSFORMH
+#define SSD1306TRANSFORMH
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ Flips and quarter turns for bitmaps in the display's page format (byte = one column of 8 rows, a page of `width`
+ bytes after another). Rotations are built on an 8x8 bit transpose done in one 64 bit word, so a whole 8x8 block
+ moves in a handful of shifts instead of 64 separate bits. Mirrors and the half turn are always done in place,
+ quarter turns can be in place (dst == src) only when the bitmap is square, otherwise dst needs
+ height * ((width + 7) / 8) bytes. Rows past the height in the last page always come out clear.
+*/
+
+uint64_t Transpose8x8(uint64_t tile);
+
+void TransposeBitmap(const uint8_t *src, uint8_t *dst, int width, int height);
+void RotateBitmap90(const uint8_t *src, uint8_t *dst, int width, int height);   // clockwise
+void RotateBitmap270(const uint8_t *src, uint8_t *dst, int width, int height);  // anticlockwise
+void RotateBitmap180(uint8_t *img, int width, int height);
+void MirrorBitmapX(uint8_t *img, int width, int height); // left to right
+void MirrorBitmapY(uint8_t *img, int width, int height); // top to bottom
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SSD1306TRANSPORTH
+#define SSD1306TRANSPORTH
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// This one gets included from both the C driver and C++, so it does its own extern "C" instead of
+// putting it on every line like ssd1306_i2c.h
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Everything the driver sends to the display goes through one of these. A write is one bus transaction:
+/// the address, then `head` (a control byte and maybe some commands), then `rows` runs of `width` bytes,
+/// each run `stride` bytes apart in buf. buf can be NULL if width or rows is 0
+struct ssd1306_transport {
+    void (*write)(void *ctx, const uint8_t *head, int headLen, const uint8_t *buf, int width, int rows, int stride);
+    void *ctx;
+};
+
+// the hardware i2c block on i2c_default, only there if the board has one. This is the default
+extern const struct ssd1306_transport ssd1306_i2c_transport;
+
+// write-only i2c done by a PIO state machine (ssd1306_pio.c), set it up with SSD1306_use_pio_bus
+extern const struct ssd1306_transport ssd1306_pio_transport;
+bool SSD1306_use_pio_bus(unsigned pioIndex, unsigned sdaPin, unsigned sclPin, unsigned khz, uint8_t address);
+
+void SSD1306_set_transport(const struct ssd1306_transport *transport);
+const struct ssd1306_transport *SSD1306_get_transport(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif